@@ -23,6 +23,8 @@ import os
 import os.path as pth
 import argparse as ap
 
+import numpy as np
+
 from inmet.gmt import GMT, get_ranges, raster_parser, gen_tuple, multi_parser
 
 def parse_arguments():
@@ -149,6 +151,20 @@ def parse_arguments():
         type=float,
         help="Step of colorbar ticks.")
     
+    parser.add_argument(
+        "--lod",
+        nargs="?",
+        default=None,
+        type=float,
+        help="Width of one map in inches. If set, at most one point per "
+             "output pixel (width * dpi pixels) is plotted.")
+    
+    parser.add_argument(
+        "--lod_mean",
+        action="store_true",
+        help="Plot the mean of the points of the pixels instead of "
+             "representative points.")
+    
     return parser.parse_args()
     
 def main():
@@ -172,7 +188,24 @@ def main():
     # 2 additional coloumns for coordinates, float64s are expected
     bindef = "{}d".format(args.ncols + 2)
     
-    if args.xy_range is None or args.z_range is None:
+    # with --lod the data is read anyway, the ranges come from the index
+    # and the data instead of another pass of gmtinfo over the file
+    if args.lod is not None:
+        from inmet.raster import LOD
+        
+        data = np.fromfile(infile, dtype=np.float64).reshape(-1, args.ncols + 2)
+        lod = LOD(data)
+        
+        xmin, xmax, ymin, ymax = lod.extent()
+        _xy_range = (xmin - args.xy_add, xmax + args.xy_add,
+                     ymin - args.xy_add, ymax + args.xy_add)
+        
+        if args.z_range is None:
+            _z_range = (np.nanmin(data[:, 2:]) - args.z_add,
+                        np.nanmax(data[:, 2:]) + args.z_add)
+        
+        del data
+    elif args.xy_range is None or args.z_range is None:
         _xy_range, _z_range = get_ranges(data=infile, binary=bindef,
                                          xy_add=args.xy_add, z_add=args.z_add)
     
@@ -187,6 +220,18 @@ def main():
         z_range = args.z_range
     
 
+    # decimated copy of the input, its size depends only on the resolution
+    if args.lod is not None:
+        nx = max(1, int(args.lod * args.dpi))
+        ny = max(1, int(nx * (xy_range[3] - xy_range[2])
+                           / (xy_range[1] - xy_range[0])))
+        
+        infile = name + "_lod.dat"
+        lod.decimate(infile, xy_range, nx, ny,
+                     reduce="mean" if args.lod_mean else "representative")
+        
+        del lod
+    
     if args.idx is None:
         idx = range(args.ncols)
     else:
@@ -241,4 +286,7 @@ def main():
     
     os.remove("tmp.cpt")
     
+    if args.lod is not None:
+        os.remove(infile)
+    
     del gmt
@@ -21,5 +21,7 @@ from .utils import *
 from .aux import *
 from .polyfit import *
 from .satorbit import *
+from .spatial import *
+from .raster import *
 
 set_ellipsoid("WGS84")
\ No newline at end of file
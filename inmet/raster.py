@@ -0,0 +1,109 @@
+import numpy as np
+
+import inmet as im
+from ctypes import *
+from inmet.spatial import opt_arr
+
+
+__all__ = {
+    "grid_ps",
+    "LOD"
+}
+
+
+lib = im.CLib("inmet_aux")
+
+c_grid_ps = lib.wrap("grid_ps", [im.in_arr, im.in_arr, im.in_arr, c_double,
+                                 c_double, c_double, c_double, im.c_idx,
+                                 im.c_idx, c_int, c_char_p, c_char_p,
+                                 c_char_p, opt_arr])
+
+lod_new = lib.wrap("lod_new", [im.in_arr, POINTER(c_void_p)])
+lod_delete = lib.wrap("lod_delete", [c_void_p])
+lod_extent = lib.wrap("lod_extent", [c_void_p, POINTER(c_double)])
+lod_select = lib.wrap("lod_select", [c_void_p, im.in_arr, c_double, c_double,
+                                     c_double, c_double, im.c_idx, im.c_idx,
+                                     c_int, c_char_p, POINTER(im.c_idx)])
+
+
+# order of the bands, same as the bits of raster::stats
+stat_bits = (("count", 1), ("mean", 2), ("median", 4), ("std", 8))
+
+
+def grid_ps(x, y, v, x0, y0, dx, dy, nx, ny, path=None,
+            stats=("count", "mean", "median", "std"),
+            projection="Geographic Lat/Lon", extra="WGS-84"):
+    """
+    Bins PS values into a regular grid. (x0, y0) is the upper left corner
+    of the upper left cell, rows run from north to south. Returns the
+    selected statistics as a float32 array of shape (number of stats, ny,
+    nx). Empty cells have a count of 0 and NaN mean, median and std, std
+    is also NaN for cells of a single point. If path is given the bands
+    are also written as an ENVI file (path and path.hdr).
+    """
+    which = sum(bit for name, bit in stat_bits if name in stats)
+    
+    unknown = set(stats) - set(name for name, _ in stat_bits)
+    assert not unknown, "Unknown statistics: %s" % ", ".join(unknown)
+    assert which, "At least one statistic should be selected."
+    
+    nb = sum(1 for name, _ in stat_bits if name in stats)
+    out = np.empty((nb, ny, nx), dtype=np.float32)
+    
+    enc = lambda s: None if s is None else s.encode("ascii")
+    
+    c_grid_ps(np.asarray(x, dtype=np.float64),
+              np.asarray(y, dtype=np.float64),
+              np.asarray(v, dtype=np.float64), x0, y0, dx, dy, nx, ny, which,
+              enc(path), enc(projection), enc(extra), out)
+    
+    return out
+
+
+class LOD(object):
+    """
+    Level-of-detail (quadtree) index of scattered points for plotting.
+    data has one row per point, the first two columns are x and y, as in
+    the GMT binary files of plot_scatter.py. The index is built once and
+    can be decimated for any extent and resolution.
+    """
+    
+    reduces = {"representative": 0, "mean": 1}
+    
+    def __init__(self, data):
+        self.data = np.ascontiguousarray(data, dtype=np.float64)
+        self.lod = c_void_p()
+        lod_new(self.data, byref(self.lod))
+    
+    
+    def __del__(self):
+        if getattr(self, "lod", None):
+            lod_delete(self.lod)
+    
+    
+    def extent(self):
+        """
+        Bounds of the points as (xmin, xmax, ymin, ymax), known from
+        building the index without reading the data again.
+        """
+        ext = (c_double * 4)()
+        lod_extent(self.lod, ext)
+        
+        return tuple(ext)
+    
+    
+    def decimate(self, path, extent, nx, ny, reduce="representative"):
+        """
+        Writes at most one row per pixel of the nx x ny raster covering
+        extent (xmin, xmax, ymin, ymax) to path in GMT native binary
+        format. reduce is "representative" (a point of the densest cell)
+        or "mean" (average of the points of the pixel). Returns the number
+        of rows written.
+        """
+        nout = im.c_idx()
+        xmin, xmax, ymin, ymax = extent
+        
+        lod_select(self.lod, self.data, xmin, xmax, ymin, ymax, nx, ny,
+                   self.reduces[reduce], path.encode("ascii"), byref(nout))
+        
+        return nout.value
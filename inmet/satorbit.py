@@ -18,69 +18,242 @@ from __future__ import print_function
 import numpy as np
 # from gnuplot import Gnuplot, linedef
 import inmet as im
+from ctypes import *
+from datetime import date as Date
 
 
-__all__ = ["SatOrbit"]
+__all__ = ["SatOrbit", "MetaFile", "OrbitCatalog"]
 
 
-class SatOrbit(im.Save):
-    def __init__(self, path, mode):
+kinds = {"monomial": 0, "chebyshev": 1, "spline": 2}
+
+
+class OrbitPoly(im.CStruct):
+    """ orbit_poly of satorbit/orbit.h """
+    _fields_ = [
+        ("kind", c_int),
+        ("n", c_int),
+        ("nseg", c_int),
+        ("t0", c_double),
+        ("t1", c_double),
+        ("coeffs", POINTER(c_double)),
+        ("dcoeffs", POINTER(c_double)),
+        ("map", c_void_p)
+    ]
+
+
+# header of the binary orbit caches (.borb), see satorbit/orbit.h
+cache_header = np.dtype([
+    ("magic", "S8"),
+    ("kind", np.int32),
+    ("n", np.int32),
+    ("nseg", np.int32),
+    ("reserved", np.int32),
+    ("t0", np.double),
+    ("t1", np.double),
+    ("mu0", np.double, 3)
+])
+
+
+# orbit catalogues (.corb), see satorbit/catalog.h
+catalog_header = np.dtype([
+    ("magic", "S8"),
+    ("count", np.int32),
+    ("first_day", np.int32),
+    ("ndays", np.int32),
+    ("reserved", np.int32),
+    ("days", np.int64),
+    ("entries", np.int64),
+    ("pad", "S24")
+])
+
+catalog_entry = np.dtype([
+    ("date", np.int32),
+    ("status", np.int32),
+    ("nsv", np.int32),
+    ("dof", np.int32),
+    ("mu0", np.double, 3),
+    ("offset", np.int64),
+    ("input", np.int32),
+    ("reserved", np.int32, 3)
+])
+
+
+lib = im.CLib("inmet_aux")
+
+calc_azi_inc = lib.wrap("calc_azi_inc", [OrbitPoly, im.in_arr, im.out_arr,
+                                         c_double, im.c_idx, c_int])
+
+orbit_states = lib.wrap("orbit_states", [OrbitPoly, im.in_arr, im.out_arr])
+
+orbit_cache_write = lib.wrap("orbit_cache_write", [c_char_p, OrbitPoly,
+                                                   POINTER(c_double)])
+
+meta_open = lib.wrap("meta_open", [c_char_p], restype=c_void_p)
+meta_close = lib.wrap("meta_close", [c_void_p], restype=None)
+meta_value = lib.wrap("meta_value", [c_void_p, c_char_p, c_char_p,
+                                     POINTER(c_size_t)], restype=c_void_p)
+
+# returns a count, not a status
+meta_state_vectors = lib.lib.meta_state_vectors
+meta_state_vectors.restype = c_int
+meta_state_vectors.argtypes = [c_void_p, POINTER(c_double), c_int,
+                               POINTER(c_int)]
+
+# returns the number of orbits catalogued
+orbit_catalog_build = lib.lib.orbit_catalog_build
+orbit_catalog_build.restype = c_int
+orbit_catalog_build.argtypes = [c_char_p, c_int, POINTER(c_char_p), c_int,
+                                c_int, c_double, c_int, c_void_p]
+
+
+class MetaFile(object):
+    """
+    DORIS .res or GAMMA .par metadata, the file is mapped and its keys and
+    sections are indexed once by satorbit/metafile.cpp.
+    """
+    def __init__(self, path):
+        self.meta = meta_open(path.encode("ascii"))
         
-        if mode == "fit_file":
-            self.read_fit(path)
-        elif mode == "doris" or mode == "gamma":
-            self.read_orbits(path, mode)
+        if self.meta is None:
+            raise IOError("Could not open %s!" % path)
     
     
-    def read_orbits(self, path, preproc):
-        with open(path, "r") as f:
-            lines = f.readlines()
+    def __del__(self):
+        if getattr(self, "meta", None) is not None:
+            meta_close(self.meta)
+            self.meta = None
+    
+    
+    def value(self, key, section=None, dtype=str):
+        """
+        Value of key, e.g. value("First_line", "crop", int). Numeric types
+        convert the first word of the value. None if key is missing.
+        """
+        section = None if section is None else section.encode("ascii")
+        n = c_size_t()
         
-        if preproc == "doris":
-            datanum = [(ii, line) for ii, line in enumerate(lines)
-                        if line.startswith("NUMBER_OF_DATAPOINTS:")]
+        ptr = meta_value(self.meta, section, key.encode("ascii"), byref(n))
         
-            if len(datanum) != 1:
-                raise ValueError("More than one or none of the lines contain the "
-                                 "number of datapoints.")
+        if ptr is None:
+            return None
         
-            idx = datanum[0][0]
-            datanum = int(datanum[0][1].split(":")[1])
-            
-            data = np.fromstring("".join(lines[idx + 1:idx + datanum + 1]),
-                                 count=datanum * 4, dtype=np.double, sep=" ")\
-                                 .reshape((datanum, 4))
+        value = string_at(ptr, n.value).decode("latin-1")
+        
+        return value if dtype is str else dtype(value.split()[0])
+    
     
-            time = data[:,0]
-            coords = data[:,1:]
+    def state_vectors(self):
+        """
+        t, x, y, z, vx, vy, vz rows, velocities are nan if the file has
+        none.
+        """
+        n = meta_state_vectors(self.meta, None, 0, None)
         
-        elif preproc == "gamma":
-            datanum = [(ii, line) for ii, line in enumerate(lines)
-                       if line.startswith("number_of_state_vectors:")]
+        if n < 1:
+            raise ValueError("No state vectors found!")
+        
+        sv = np.empty((n, 7), dtype=np.double)
+        
+        if meta_state_vectors(self.meta, sv.ctypes.data_as(POINTER(c_double)),
+                              n, None) != n:
+            raise ValueError("Could not read the state vectors!")
+        
+        return sv
+
+
+class OrbitCatalog(object):
+    """
+    Orbits of a stack written by daisy catalog_orbits or build, mapped
+    with numpy. entries holds the fit diagnostics sorted by date, an
+    epoch is found with one lookup in the day table.
+    """
+    statuses = ("ok", "unreadable", "no orbit", "no date", "fit failed",
+                "duplicate")
+    epoch = Date(1970, 1, 1).toordinal()
     
-            if len(datanum) != 1:
-                raise ValueError("More than one or none of the lines contains the "
-                                 "number of datapoints.")
-            
-            idx = datanum[0][0]
-            datanum = int(datanum[0][1].split(":")[1])
-            
-            t_first = float(lines[idx + 1].split(":")[1].split()[0])
-            t_step  = float(lines[idx + 2].split(":")[1].split()[0])
-            
-            time = np.arange(t_first, t_first + 7 * t_step, t_step)
-            
-            coords = \
-            np.asarray([str2orbit(get_par(f"state_vector_position_{ii+1}",
-                        lines)) for ii in range(data_num)])
-            
-        else:
+    def __init__(self, path):
+        head = np.fromfile(path, dtype=catalog_header, count=1)
+        
+        if head.shape[0] != 1 or head["magic"][0] != b"INMCAT01":
+            raise ValueError("%s is not an orbit catalogue!" % path)
+        
+        head = head[0]
+        count, ndays = int(head["count"]), int(head["ndays"])
+        
+        self.path, self.first_day = path, int(head["first_day"])
+        
+        self.entries = np.memmap(path, dtype=catalog_entry, mode="r",
+                                 offset=int(head["entries"]),
+                                 shape=(count,)) \
+                       if count > 0 else np.empty(0, dtype=catalog_entry)
+        
+        self.days = np.memmap(path, dtype=np.int32, mode="r",
+                              offset=int(head["days"]), shape=(ndays,)) \
+                    if ndays > 0 else np.empty(0, dtype=np.int32)
+    
+    
+    @classmethod
+    def build(cls, path, inputs, deg, kind="monomial", segment=0.0,
+              hermite=False):
+        """
+        Fits the orbits of the .res or .par files in inputs in parallel
+        and writes the catalogue to path, options are those of daisy
+        poly_orbit.
+        """
+        paths = (c_char_p * len(inputs))(*(p.encode("ascii")
+                                           for p in inputs))
+        
+        if orbit_catalog_build(path.encode("ascii"), len(inputs), paths,
+                               kinds[kind], deg, segment, int(hermite),
+                               None) < 0:
+            raise IOError("Could not write %s!" % path)
+        
+        return cls(path)
+    
+    
+    def find(self, date):
+        """
+        SatOrbit of the acquisition on date (yyyymmdd or datetime.date).
+        """
+        if not isinstance(date, Date):
+            date = int(date)
+            date = Date(date // 10000, date // 100 % 100, date % 100)
+        
+        day = date.toordinal() - self.epoch - self.first_day
+        
+        if day < 0 or day >= self.days.shape[0] or self.days[day] < 0:
+            raise KeyError("No orbit for %s!" % date)
+        
+        return SatOrbit(self.path, "borb",
+                        int(self.entries[self.days[day]]["offset"]))
+
+
+class SatOrbit(im.Save):
+    def __init__(self, path, mode, offset=0):
+        
+        if mode == "fit_file":
+            self.read_fit(path)
+        elif mode == "porb":
+            self.read_porb(path)
+        elif mode == "borb":
+            self.read_borb(path, offset)
+        elif mode == "doris" or mode == "gamma":
+            self.read_orbits(path, mode)
+    
+    
+    def read_orbits(self, path, preproc):
+        if preproc != "doris" and preproc != "gamma":
             raise ValueError('preproc should be either "doris" or "gamma" '
                              'not %s' % preproc)
         
-        self.time = time
-        self.coords = coords
-        self.datanum = datanum
+        # precise orbits of .res files, state vectors of .par files
+        sv = MetaFile(path).state_vectors()
+        
+        self.time = sv[:,0]
+        self.coords = sv[:,1:4]
+        self.datanum = sv.shape[0]
+        self.velocities = None if np.isnan(sv[:,4:]).any() else sv[:,4:]
 
 
     def read_fit(self, fit_file):
@@ -107,6 +280,61 @@ class SatOrbit(im.Save):
                                     dtype=np.double).reshape(3, deg + 1)
 
     
+    def read_porb(self, path):
+        """
+        Reads a polynomial orbit file written by daisy poly_orbit. Spline
+        orbits hold nseg rows of coefficients for every coordinate.
+        """
+        with open(path, "r") as f:
+            head = f.readline().split()
+            t_start, t_stop = float(f.readline()), float(f.readline())
+            coeffs = np.fromstring(f.read(), dtype=np.double, sep=" ")
+        
+        self.deg = int(head[0])
+        self.kind = head[1] if len(head) > 1 else "monomial"
+        self.nseg = int(head[2]) if self.kind == "spline" else 1
+        self.t_start, self.t_stop = t_start, t_stop
+        
+        n = self.nseg * (self.deg + 1)
+        self.porb = np.ascontiguousarray(coeffs[:3 * n].reshape(3, n))
+        self.dporb, self.mu0 = None, None
+    
+    
+    def read_borb(self, path, offset=0):
+        """
+        Maps a binary orbit cache written by daisy poly_orbit --cache or
+        save_cache, or the block at offset of an orbit catalogue. Velocity
+        and acceleration coefficients come with it.
+        """
+        head = np.memmap(path, dtype=cache_header, mode="r", offset=offset,
+                         shape=(1,))[0]
+        
+        if head["magic"] != b"INMORB01":
+            raise ValueError("%s is not an orbit cache!" % path)
+        
+        n, nseg = int(head["n"]), int(head["nseg"])
+        
+        data = np.memmap(path, dtype=np.double, mode="r",
+                         offset=offset + cache_header.itemsize,
+                         shape=(9, nseg * n))
+        
+        self.deg, self.nseg = n - 1, nseg
+        self.kind = {v: k for k, v in kinds.items()}[int(head["kind"])]
+        self.t_start, self.t_stop = float(head["t0"]), float(head["t1"])
+        self.mu0 = np.array(head["mu0"])
+        self.porb, self.dporb = data[:3], data[3:]
+    
+    
+    def save_cache(self, path):
+        """
+        Writes the orbit read from a .porb or .borb file as a binary orbit
+        cache.
+        """
+        mu0 = None if self.mu0 is None else (c_double * 3)(*self.mu0)
+        
+        orbit_cache_write(path.encode("ascii"), self.orbit_poly(), mu0)
+    
+    
     def fit_orbit(self, deg=3):
         self.fit = im.PolyFit(self.time, self.coords, deg, order="cols")
         
@@ -144,11 +372,45 @@ class SatOrbit(im.Save):
                         .format(" ".join(str(coord) for coord in self.mean_coords)))
         
 
-    def azi_inc(fit_file, coords, is_lonlat=True, max_iter=1000):
+    def azi_inc(self, coords, is_lonlat=True, max_iter=50, tol=1e-11):
+        """
+        Azimuth and incidence angles [degree] of the points in coords
+        (longitude, latitude [degree], height [m] or X, Y, Z [m] rows)
+        at zero Doppler, from an orbit read from a .porb file. The zero
+        Doppler time is found with Newton steps until the cosine between
+        the velocity and the line of sight is below tol.
+        """
+        coords = np.ascontiguousarray(coords, dtype=np.double)
+        azi_inc = np.empty((coords.shape[0], 2), dtype=np.double)
+        
+        calc_azi_inc(self.orbit_poly(), coords, azi_inc, tol, max_iter,
+                     int(is_lonlat))
+        
+        return azi_inc
+    
+    
+    def states(self, time):
+        """
+        Positions and velocities (x, y, z, vx, vy, vz rows) at the given
+        times from an orbit read from a .porb file. Sorted times are
+        evaluated segment by segment.
+        """
+        time = np.ascontiguousarray(time, dtype=np.double)
+        states = np.empty((time.shape[0], 6), dtype=np.double)
+        
+        orbit_states(self.orbit_poly(), time, states)
         
-        return ina.azi_inc(self.t_start, self.t_stop, self.t_mean,
-                           self.mean_coords, self.centered, self.coeffs,
-                           self.deg, max_iter, is_lonlat, coords)
+        return states
+    
+    
+    def orbit_poly(self):
+        dporb = None if self.dporb is None \
+                else self.dporb.ctypes.data_as(POINTER(c_double))
+        
+        return OrbitPoly(kinds[self.kind], self.deg + 1, self.nseg,
+                         self.t_start, self.t_stop,
+                         self.porb.ctypes.data_as(POINTER(c_double)),
+                         dporb, None)
 
     
     def plot_orbit(self, plotfile, nsamp=100):
@@ -201,8 +463,3 @@ class SatOrbit(im.Save):
             
             gpt.plot(points, fit)
 
-
-def str2orbit(line):
-    line_split = line.split()
-    
-    return [float(line_split[0]), float(line_split[1]), float(line_split[2])]
@@ -0,0 +1,224 @@
+import numpy as np
+
+import inmet as im
+from ctypes import *
+
+
+__all__ = {
+    "PSIndex",
+    "colocate"
+}
+
+
+class opt_arr(object):
+    """ Output array that can be None (NULL on the C++ side). """
+    @classmethod
+    def from_param(cls, obj):
+        return None if obj is None else im.CArray.from_param(obj)
+
+
+lib = im.CLib("inmet_aux")
+
+kdtree_new = lib.wrap("kdtree_new", [im.in_arr, POINTER(c_void_p)])
+kdtree_delete = lib.wrap("kdtree_delete", [c_void_p])
+kdtree_knn = lib.wrap("kdtree_knn", [c_void_p, im.in_arr, im.c_idx, c_double,
+                                     im.out_arr, im.out_arr])
+kdtree_radius = lib.wrap("kdtree_radius", [c_void_p, im.in_arr, c_double,
+                                           im.out_arr, opt_arr, opt_arr])
+kdtree_interpolate = lib.wrap("kdtree_interpolate",
+                              [c_void_p, im.in_arr, im.in_arr, im.c_idx,
+                               c_double, c_double, im.out_arr, im.out_arr])
+kdtree_krige = lib.wrap("kdtree_krige",
+                        [c_void_p, im.in_arr, im.in_arr, im.c_idx, c_double,
+                         c_int, c_double, c_double, c_double, im.out_arr,
+                         im.out_arr, im.out_arr])
+kdtree_variogram = lib.wrap("kdtree_variogram",
+                            [c_void_p, im.in_arr, c_double, c_double,
+                             im.c_idx, im.out_arr, im.out_arr, im.out_arr])
+
+
+models = {"spherical": 0, "exponential": 1, "gaussian": 2}
+
+
+def make_coords(lon, lat, h=None):
+    cols = (lon, lat) if h is None else (lon, lat, h)
+    
+    return np.ascontiguousarray(np.column_stack(cols), dtype=np.float64)
+
+
+class PSIndex(object):
+    """
+    Spatial index (kd-tree) of PSs built once in the C++ library.
+    Coordinates are longitude, latitude [degree] and height [m],
+    distances are in metres as in daisy.
+    """
+    
+    def __init__(self, lon, lat, h=None):
+        self.tree, self.n = c_void_p(), len(lon)
+        kdtree_new(make_coords(lon, lat, h), byref(self.tree))
+    
+    
+    def __del__(self):
+        if getattr(self, "tree", None):
+            kdtree_delete(self.tree)
+    
+    
+    def knn(self, lon, lat, h=None, k=8, max_dist=0.0):
+        """
+        k nearest PSs of the points, returns indices and distances with
+        shape (number of points, k); missing ones are -1 and NaN.
+        """
+        coords = make_coords(lon, lat, h)
+        
+        nbr = np.empty((coords.shape[0], k), dtype=np.int64)
+        dist = np.empty((coords.shape[0], k), dtype=np.float64)
+        
+        kdtree_knn(self.tree, coords, k, max_dist, nbr, dist)
+        
+        return nbr, dist
+    
+    
+    def radius(self, lon, lat, h=None, radius=100.0):
+        """
+        PSs within radius [m] of the points. The neighbours of the i-th
+        point are nbr[first[i]:first[i + 1]], sorted by distance.
+        """
+        coords = make_coords(lon, lat, h)
+        first = np.empty(coords.shape[0] + 1, dtype=np.int64)
+        
+        kdtree_radius(self.tree, coords, radius, first, None, None)
+        
+        nbr = np.empty(first[-1], dtype=np.int64)
+        dist = np.empty(first[-1], dtype=np.float64)
+        
+        kdtree_radius(self.tree, coords, radius, first, nbr, dist)
+        
+        return first, nbr, dist
+    
+    
+    def interpolate(self, values, lon, lat, h=None, k=0, radius=0.0,
+                    power=2.0):
+        """
+        Inverse distance weighted interpolation of values (one row per PS,
+        any number of columns) to the points from the k nearest PSs
+        and/or the PSs within radius [m], weights are 1 / d^power (power
+        2 gives the weights of daisy). Returns the interpolated values
+        (NaN where no PS was found) and the number of PSs used.
+        """
+        coords = make_coords(lon, lat, h)
+        values = np.ascontiguousarray(values, dtype=np.float64)
+        
+        vals = values.reshape(values.shape[0], -1)
+        
+        out = np.empty((coords.shape[0], vals.shape[1]), dtype=np.float64)
+        count = np.empty(coords.shape[0], dtype=np.int64)
+        
+        kdtree_interpolate(self.tree, coords, vals, k, radius, power, out,
+                           count)
+        
+        if values.ndim == 1:
+            out = out.reshape(-1)
+        
+        return out, count
+    
+    
+    def krige(self, values, lon, lat, h=None, k=16, radius=0.0,
+              model="spherical", nugget=0.0, sill=1.0, range=1.0):
+        """
+        Ordinary kriging of values (one row per PS, any number of columns)
+        to the points from the k nearest PSs not farther than radius [m]
+        (radius 0 means no limit). The variogram is nugget + sill *
+        f(h / range) with h, range in metres, model is "spherical",
+        "exponential" or "gaussian". Returns the kriged values (NaN where
+        no PS was found), the kriging variance and the number of PSs used.
+        """
+        coords = make_coords(lon, lat, h)
+        values = np.ascontiguousarray(values, dtype=np.float64)
+        
+        vals = values.reshape(values.shape[0], -1)
+        
+        out = np.empty((coords.shape[0], vals.shape[1]), dtype=np.float64)
+        var = np.empty(coords.shape[0], dtype=np.float64)
+        count = np.empty(coords.shape[0], dtype=np.int64)
+        
+        kdtree_krige(self.tree, coords, vals, k, radius, models[model],
+                     nugget, sill, range, out, var, count)
+        
+        if values.ndim == 1:
+            out = out.reshape(-1)
+        
+        return out, var, count
+    
+    
+    def variogram(self, values, max_lag, nbins=20, fraction=1.0, seed=0):
+        """
+        Empirical semivariogram of values (one per PS) up to max_lag [m]
+        in nbins bins. With fraction < 1 only that fraction of the PSs
+        (chosen reproducibly by seed) are used as first points of the
+        pairs. Returns the mean lag, gamma (NaN for empty bins) and the
+        number of pairs of the bins.
+        """
+        lag = np.empty(nbins, dtype=np.float64)
+        gamma = np.empty(nbins, dtype=np.float64)
+        count = np.empty(nbins, dtype=np.int64)
+        
+        values = np.ascontiguousarray(values, dtype=np.float64)
+        
+        kdtree_variogram(self.tree, values, max_lag, fraction, seed, lag,
+                         gamma, count)
+        
+        return lag, gamma, count
+    
+    
+    def interpolate_grid(self, values, lon0, lat0, dlon, dlat, nlon, nlat,
+                         h=0.0, **kwargs):
+        """
+        Interpolation to the nodes of a longitude, latitude grid, (lon0,
+        lat0) is the upper left node, rows run from north to south.
+        Returns arrays of shape (nlat, nlon[, number of columns]). For
+        horizontal distances the index should be built without heights.
+        """
+        lon, lat = np.meshgrid(lon0 + dlon * np.arange(nlon),
+                               lat0 - dlat * np.arange(nlat))
+        
+        out, count = self.interpolate(values, lon.ravel(), lat.ravel(),
+                                      np.full(lon.size, h), **kwargs)
+        
+        return out.reshape((nlat, nlon) + out.shape[1:]), \
+               count.reshape(nlat, nlon)
+
+
+def colocate(stations, tracks, k=None, radius=None):
+    """
+    PSs around GNSS stations for every track.
+    
+    stations: (lon, lat) or (lon, lat, h) of the stations
+    tracks: dictionary of track name -> (lon, lat, h, v) of PSs
+    k, radius: k nearest PSs and/or PSs within radius [m]
+    
+    Returns dictionary of track name -> dict with "nbr" ((nbr, dist) of
+    the k nearest PSs or (first, nbr, dist) of the PSs within radius),
+    the IDW mean velocity "v" and the number of PSs used "count" per
+    station.
+    """
+    assert k is not None or radius is not None, "k or radius is required"
+    
+    ret = {}
+    
+    for name, (lon, lat, h, v) in tracks.items():
+        index = PSIndex(lon, lat, h)
+        
+        if k is not None:
+            nbr = index.knn(*stations, k=k,
+                            max_dist=radius if radius is not None else 0.0)
+        else:
+            nbr = index.radius(*stations, radius=radius)
+        
+        mean, count = index.interpolate(v, *stations,
+                                        k=k if k is not None else 0,
+                                        radius=radius if radius is not None
+                                        else 0.0)
+        
+        ret[name] = {"nbr": nbr, "v": mean, "count": count}
+    
+    return ret
@@ -66,11 +66,11 @@ enum class dtype {
 struct Error {
     static constexpr auto buffer_size = 1024;
     
-    char const str[buffer_size] = nullptr;
+    char const* str = nullptr;
     bool owned = false;
     
     Error() = default;
-    ~Error() default;
+    ~Error() = default;
 };
 
 
@@ -258,12 +258,12 @@ struct ArrayMeta {
 
     idx const operator()(idx const ii, idx const jj) const
     {
-        return ii * strides[0] + jj * strides[jj];
+        return ii * strides[0] + jj * strides[1];
     }
 
     idx const operator()(idx const ii, idx const jj, idx const kk) const
     {
-        return ii * strides[0] + jj * strides[jj] + kk * strides[kk];
+        return ii * strides[0] + jj * strides[1] + kk * strides[2];
     }
 
     idx const operator()(idx const ii, idx const jj, idx const kk,
@@ -36,14 +36,26 @@ def main():
 
     args = parse_args()
     
-    flags = ["-O3", "-march=native"]
+    # no fused multiply-add contraction, results should not depend on the
+    # instruction set of the machine
+    flags = ["-O3", "-march=native", "-ffp-contract=off", "-fopenmp"]
     
-    compile_project("daisy.c", outdir=join("..", "..", "bin"), libs=["m"],
+    # orbit fitting is done with Eigen in satorbit/orbit.cpp, .res and .par
+    # files are read by satorbit/metafile.cpp, stacks are catalogued by
+    # satorbit/catalog.cpp
+    compile_project("daisy.c", join("..", "satorbit", "orbit.cpp"),
+                    join("..", "satorbit", "metafile.cpp"),
+                    join("..", "satorbit", "catalog.cpp"),
+                    outdir=join("..", "..", "bin"), libs=["m", "stdc++"],
+                    inc_dirs=[join("..", "satorbit"), join("..", "ThirdParty")],
                     flags=flags)
 
     if args.clean:
         print("\nCleaning up object file.", end="\n\n")
         remove("daisy.o")
+        remove(join("..", "satorbit", "orbit.o"))
+        remove(join("..", "satorbit", "metafile.o"))
+        remove(join("..", "satorbit", "catalog.o"))
 
 
 if __name__ == "__main__":
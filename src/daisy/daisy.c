@@ -2,6 +2,16 @@
 #include <tgmath.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "orbit.h"
+#include "metafile.h"
+#include "catalog.h"
 
 /* This is the compilation of programs written by Prof. Laszlo Banyai
  * (Geodetic and Geophysical Institute of the Hungarian Academy of Sciences),
@@ -21,7 +31,7 @@
 #define Minarg 2
 
 // available modules
-#define Modules "data_select, dominant, poly_orbit, integrate, zero_select"
+#define Modules "mosaic, clip, data_select, neighbours, dominant, dominant_update, poly_orbit, catalog_orbits, integrate, integrate_grid, zero_select"
 
 // auxilliary IO functions
 #define error(string) fprintf(stderr, string)
@@ -50,6 +60,11 @@
 #define E2 (WA * WA - WB * WB) / WA / WA
 #define distance(x, y, z) sqrt((y) * (y) + (x) * (x) + (z) * (z))
 
+// defaults of the zero-Doppler solver: tolerance of the cosine between
+// the satellite velocity and the line of sight, maximum iterations
+#define Doppler_tol 1.0e-11
+#define Doppler_maxiter 50
+
 typedef struct { float la, fi; } psxy;
 
 typedef struct {
@@ -61,10 +76,115 @@ typedef struct { double x, y, z, f, l, h; } station; // [m,rad]
 
 typedef struct { double t, x, y, z; } torb;
 
+typedef struct { double la, fi, he, v1, v2; } psxyd; // dominant point [degree,m,mm/year]
+
+/* Uniform grid of cells over the longitude, latitude plane. Points are
+ * sorted into the cells with counting sort so the indices of points
+ * falling into the k-th cell are idx[first[k]] ... idx[first[k + 1] - 1]
+ * in increasing order. */
+typedef struct {
+    double la0, fi0, cell; // lower left corner and size of cells [degree]
+    int nla, nfi;          // number of cells along longitude and latitude
+    int * first, * idx;
+} psgrid;
+
+/* Header of the neighbour graph file written by the neighbours module. It
+ * is followed by the row offsets (n1 + n2 + 1 long longs) and the indices
+ * of the neighbours (nnz ints), distances are not stored as the users
+ * recompute them from the coordinates. Points are numbered as ascending
+ * PSs followed by descending ones, rows are sorted and do not contain the
+ * point itself. The hash ties the graph to the exact input PSs. */
+typedef struct {
+    char magic[8];      // "DAISYNBG"
+    int version, n1, n2;
+    float radius;       // [m]
+    long long nnz;      // number of neighbours
+    unsigned int hash;  // hash of PS coordinates
+    int reserved[7];
+} nbghead;
+
+typedef struct {
+    nbghead const * head;
+    long long const * first;
+    int const * nbr;
+    size_t size;        // size of the memory mapped file
+} nbgraph;
+
+/* Pairwise summation with a fixed reduction tree. Values are combined
+ * like the digits of a binary counter: part[i] holds the sum of a block
+ * of 2^i consecutive values. The tree depends only on the number of
+ * values, it is the same as splitting the values at the largest power
+ * of two and summing the halves recursively, so sums of aligned blocks
+ * computed by different threads give the same bits. */
+typedef struct {
+    double part[64];
+    long long n;        // number of values added
+} pwsum;
+
+// candidate reference area of zero_select
+typedef struct {
+    int ic, n1, n2;         // central PS, number of asc and dsc PSs
+    double mean[2], std[2]; // asc and dsc velocities [mm/year]
+    double density;         // [PS/km^2]
+} psarea;
+
+/* Model of the zero-Doppler time around the middle of an orbit, one
+ * Newton step t = tm + v . (p - s) / (|v|^2 - a . (p - s)) from the state
+ * s, v, a at tm; it seeds the solver in integrate --warm. */
+typedef struct {
+    double t, x, y, z, vx, vy, vz, ax, ay, az, vv;
+} azmodel;
+
+// dominant point of integrate and its approximate ascending azimuth time
+typedef struct {
+    double t;
+    int i;
+} pstime;
+
+/* Polygons for clipping. The bounding box of the polygons is divided
+ * into cells, a cell is outside (0), inside (1) or crossed by edges (2).
+ * Edges are sorted into latitude bands of the cells, edges of the j-th
+ * band are first[j] ... first[j + 1] - 1, stored as structure of arrays
+ * for the vectorised crossing number test. */
+typedef struct {
+    double la0, fi0, cell; // lower left corner and size of cells [degree]
+    int nla, nfi;
+    char * state;
+    int * first;
+    double * x0, * y0, * y1, * dxdy;
+} pgclip;
+
 /************************
  * Auxilliary functions *
  ************************/
 
+static void pw_init(pwsum * s)
+{
+    s->n = 0;
+} // end pw_init
+
+static void pw_add(pwsum * s, double x)
+{
+    int i;
+    long long k;
+
+    for (i = 0, k = s->n++; k & 1; i++, k >>= 1)
+        x = s->part[i] + x;
+    s->part[i] = x;
+} // end pw_add
+
+static double pw_total(pwsum const * s)
+{
+    // blocks are added from the smallest to the largest one
+    int i;
+    double t = 0.0;
+
+    for (i = 0; i < 64; i++)
+        if ((s->n >> i) & 1) t = s->part[i] + t;
+
+    return (t);
+} // end pw_total
+
 static void cart_ell(station * sta)
 {
     // from cartesian to ellipsoidal
@@ -145,16 +265,62 @@ static int selectp(float dam, FILE * in1, psxy * in2, int ni, FILE * ou1)
     return (n);
 } // end selectp
 
-static void estim_dominant(psxys * buffer, int ps1, int ps2,
-                           FILE * lo, FILE * ou)
+static double idw_velocity(psxys const * buffer, int first, int last,
+                           station const * psd)
+{
+    /* inverse distance weighted velocity of the PSs first ... last - 1
+     * at the point psd, a PS at psd itself gives its own velocity */
+    int i;
+    double dist, dx, dy, dz;
+    pwsum sumw, sumwve;
+    station ps;
+
+    pw_init(& sumw);
+    pw_init(& sumwve);
+
+    for (i = first; i < last; i++) {
+        ps.f = (buffer + i)->fi / 180.0 * M_PI;
+        ps.l = (buffer + i)->la / 180.0 * M_PI;
+        ps.h = (buffer + i)->he;
+        ell_cart( & ps);
+
+        dx = psd->x - ps.x;
+        dy = psd->y - ps.y;
+        dz = psd->z - ps.z;
+        dist = distance(dx, dy, dz);
+
+        if (dist == 0.0) return ((buffer + i)->ve);
+
+        pw_add(& sumw, 1.0 / dist / dist); // weight
+        pw_add(& sumwve, (buffer + i)->ve / dist / dist);
+    }
+    return (pw_total(& sumwve) / pw_total(& sumw));
+} // end idw_velocity
+
+static void estim_velocities(psxys const * buffer, int ps1, int ps2,
+                             station const * psd, psxyd * dom)
+{
+    /* inverse distance weighted ascending (v1) and descending (v2)
+     * velocities at the point psd */
+
+    dom->v1 = idw_velocity(buffer, 0, ps1, psd);
+    dom->v2 = idw_velocity(buffer, ps1, ps1 + ps2, psd);
+} //end estim_velocities
+
+static void estim_dominant(psxys const * buffer, int ps1, int ps2,
+                           psxyd * dom)
 {
+    /* Sums are evaluated with pairwise summation (pw_add) so the
+     * results do not depend on the way the loops are compiled. */
     int i;
-    double dist, dx, dy, dz, sumw, sumwve;
+    pwsum sx, sy, sz;
     station ps, psd;
 
     // coordinates of dominant point - weighted mean
 
-    psd.x = psd.y = psd.z = 0.0;
+    pw_init(& sx);
+    pw_init(& sy);
+    pw_init(& sz);
 
     for (i = 0; i < (ps1 + ps2); i++) {
 
@@ -167,123 +333,653 @@ static void estim_dominant(psxys * buffer, int ps1, int ps2,
         ell_cart( & ps); // compute ps.x ps.y ps.z 
 
         if (i < ps1) {
-            psd.x += ps.x / ps1;
-            psd.y += ps.y / ps1;
-            psd.z += ps.z / ps1;
+            pw_add(& sx, ps.x / ps1);
+            pw_add(& sy, ps.y / ps1);
+            pw_add(& sz, ps.z / ps1);
         } else {
-            psd.x += ps.x / ps2;
-            psd.y += ps.y / ps2;
-            psd.z += ps.z / ps2;
+            pw_add(& sx, ps.x / ps2);
+            pw_add(& sy, ps.y / ps2);
+            pw_add(& sz, ps.z / ps2);
         } // sum (1/ps1 + 1/ps2) = 2           
     } //end for
 
-    psd.x /= 2.0;
-    psd.y /= 2.0; // weighted meam
-    psd.z /= 2.0;
+    psd.x = pw_total(& sx) / 2.0;
+    psd.y = pw_total(& sy) / 2.0; // weighted meam
+    psd.z = pw_total(& sz) / 2.0;
 
     cart_ell( & psd);
 
     //   details:
     //   fprintf(lo,"0 %16.7le %15.7le %9.3lf",psd.l/M_PI*180.0, psd.f/M_PI*180.0, psd.h);    
 
-    fprintf(ou, "%16.7le %15.7le %9.3lf", psd.l / M_PI * 180.0, psd.f / M_PI * 180.0, psd.h);
+    dom->la = psd.l / M_PI * 180.0;
+    dom->fi = psd.f / M_PI * 180.0;
+    dom->he = psd.h;
 
-    // interpolation of ascending velocities
+    estim_velocities(buffer, ps1, ps2, & psd, dom);
+} //end estim_dominant
 
-    sumwve = sumw = 0.0;
+static void write_dominant(FILE * ou, psxyd const * dom)
+{
+    fprintf(ou, "%16.7le %15.7le %9.3lf", dom->la, dom->fi, dom->he);
+    fprintf(ou, " %8.3lf", dom->v1);
+    fprintf(ou, " %8.3lf\n", dom->v2);
+} // end write_dominant
 
-    for (i = 0; i < ps1; i++) {
-        ps.f = (buffer + i)->fi / 180.0 * M_PI;
-        ps.l = (buffer + i)->la / 180.0 * M_PI;
-        ps.h = (buffer + i)->he;
-        ell_cart( & ps);
+// -----------------------------------------------------------
 
-        dx = psd.x - ps.x;
-        dy = psd.y - ps.y;
-        dz = psd.z - ps.z;
-        dist = distance(dx, dy, dz);
+static int grid_cell(psgrid const * g, double la, double fi)
+{
+    // index of the cell containing (la, fi)
+    return ((int) ((fi - g->fi0) / g->cell)) * g->nla
+          + (int) ((la - g->la0) / g->cell);
+} // end grid_cell
+
+static void grid_sort(psgrid * g, psxys const * ps, int n, double la1,
+                      double fi1)
+{
+    /* sort the n points of ps into the cells, lower left corner and cell
+     * size are already set, (la1, fi1) is the upper right corner */
+    int i, k, ncell;
 
-        sumw += 1.0 / dist / dist; // weight
-        sumwve += (buffer + i)->ve / dist / dist;
+    g->nla = (int) ((la1 - g->la0) / g->cell) + 1;
+    g->nfi = (int) ((fi1 - g->fi0) / g->cell) + 1;
+
+    if ((double) g->nla * g->nfi > 2.0e8) {
+        errorln("\n Too many grid cells (%d x %d), increase the cell size !\n",
+                g->nla, g->nfi);
+        exit(1);
     }
-    fprintf(ou, " %8.3lf", sumwve / sumw);
+    ncell = g->nla * g->nfi;
 
-    //    details:
-    //    fprintf(lo," %8.3lf",sumwve/sumw); 
+    if ((g->first = (int * ) calloc(ncell + 1, sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate grid cells\n");
+        exit(1);
+    }
+    if ((g->idx = (int * ) malloc((n > 0 ? n : 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate grid indices\n");
+        exit(1);
+    }
 
-    // interpolation of descending velocities
+    // counting sort, first[k + 1] is the number of points in k-th cell
+    for (i = 0; i < n; i++)
+        g->first[grid_cell(g, (ps + i)->la, (ps + i)->fi) + 1]++;
 
-    sumwve = sumw = 0.0;
+    for (k = 0; k < ncell; k++) g->first[k + 1] += g->first[k];
 
-    for (i = ps1; i < (ps1 + ps2); i++) {
-        ps.f = (buffer + i)->fi / 180.0 * M_PI;
-        ps.l = (buffer + i)->la / 180.0 * M_PI;
-        ps.h = (buffer + i)->he;
-        ell_cart( & ps);
-        dx = psd.x - ps.x;
-        dy = psd.y - ps.y;
-        dz = psd.z - ps.z;
-        dist = distance(dx, dy, dz);
+    for (i = 0; i < n; i++)
+        g->idx[g->first[grid_cell(g, (ps + i)->la, (ps + i)->fi)]++] = i;
+
+    // first[k] now points to the start of (k + 1)-th cell, shift back
+    for (k = ncell; k > 0; k--) g->first[k] = g->first[k - 1];
+    g->first[0] = 0;
+} // end grid_sort
+
+static void grid_build(psgrid * g, psxys const * ps, int n, double cell)
+{
+    // sort the n points of ps into cells of size cell [degree]
+    int i;
+    double la1, fi1;
 
-        sumw += 1.0 / dist / dist; // weight
-        sumwve += (buffer + i)->ve / dist / dist;
+    g->la0 = la1 = ps->la;
+    g->fi0 = fi1 = ps->fi;
+
+    for (i = 1; i < n; i++) {
+        if ((ps + i)->la < g->la0) g->la0 = (ps + i)->la;
+        if ((ps + i)->la > la1)    la1    = (ps + i)->la;
+        if ((ps + i)->fi < g->fi0) g->fi0 = (ps + i)->fi;
+        if ((ps + i)->fi > fi1)    fi1    = (ps + i)->fi;
     }
-    fprintf(ou, " %8.3lf\n", sumwve / sumw);
 
-    //    details:
-    //    fprintf(lo," %8.3lf\n",sumwve/sumw);
+    g->cell = cell;
+    grid_sort(g, ps, n, la1, fi1);
+} // end grid_build
 
-} //end estim_dominant
+static void grid_build_aligned(psgrid * g, psxys const * ps, int n,
+                               double cell, double la0, double fi0)
+{
+    // same as grid_build but cell corners are aligned to (la0, fi0)
+    int i;
+    double la1, fi1;
 
-// -----------------------------------------------------------
+    g->la0 = la1 = ps->la;
+    g->fi0 = fi1 = ps->fi;
+
+    for (i = 1; i < n; i++) {
+        if ((ps + i)->la < g->la0) g->la0 = (ps + i)->la;
+        if ((ps + i)->la > la1)    la1    = (ps + i)->la;
+        if ((ps + i)->fi < g->fi0) g->fi0 = (ps + i)->fi;
+        if ((ps + i)->fi > fi1)    fi1    = (ps + i)->fi;
+    }
 
-static int cluster(psxys * indata1, int n1, psxys * indata2, int n2,
-                   psxys * buffer, int * nb, float dam)
+    g->la0 = la0 + floor((g->la0 - la0) / cell) * cell;
+    g->fi0 = fi0 + floor((g->fi0 - fi0) / cell) * cell;
+    g->cell = cell;
+    grid_sort(g, ps, n, la1, fi1);
+} // end grid_build_aligned
+
+static void grid_free(psgrid * g)
+{
+    free(g->first);
+    free(g->idx);
+    g->first = g->idx = NULL;
+} // end grid_free
+
+static void push_int(int ** arr, int * size, int n, int value)
+{
+    // arr[n] = value, arr is reallocated if its size is not enough
+    if (n == * size) {
+        * size = 2 * * size + 16;
+        if ((* arr = (int * ) realloc(* arr, * size * sizeof(int))) == NULL) {
+            error("\nNot enough memory to allocate neighbours\n");
+            exit(1);
+        }
+    }
+    (* arr)[n] = value;
+} // end push_int
+
+static int grid_query(psgrid const * g, psxys const * ps, double la, double fi,
+                      double dm, int ** nbr, int * nnbr)
 {
-    int i, j, k;
-    double fv, dla, dfi, dd, la, fi;
-    double dm = dam / R * C * dam / R * C;
+    // indices of points closer to (la, fi) than sqrt(dm) [degree],
+    // nbr is reallocated if its size (nnbr) is not enough
+    int i, j, k, n = 0, r, ila, ifi, la0, la1, fi0, fi1;
+    double dla, dfi;
 
-    k = j = 0;
-    while (((indata1 + k)->ni == 0) && (k < n1)) k++; // skip selected PSs
+    r = (int) ceil(sqrt(dm) / g->cell);
 
-    la = (indata1 + k)->la;
-    fi = (indata1 + k)->fi;
+    ila = (int) floor((la - g->la0) / g->cell);
+    ifi = (int) floor((fi - g->fi0) / g->cell);
 
-    for (i = k; i < n1; i++) // 1 for
-    {
-        dla = (indata1 + i)->la - la;
-        dfi = (indata1 + i)->fi - fi;
-        dd = dla * dla + dfi * dfi;
-        if (((indata1 + i)->ni > 0) && (dd < dm)) { * (buffer + j) = * (indata1 + i);
-            (indata1 + i)->ni = 0;
-            j++;
-            if (j == * nb) {
-                ( * nb) ++;
-                buffer = (psxys * ) realloc(buffer, * nb * sizeof(psxys));
+    la0 = ila - r < 0 ? 0 : ila - r;
+    fi0 = ifi - r < 0 ? 0 : ifi - r;
+    la1 = ila + r >= g->nla ? g->nla - 1 : ila + r;
+    fi1 = ifi + r >= g->nfi ? g->nfi - 1 : ifi + r;
+
+    for (j = fi0; j <= fi1; j++)
+        for (i = la0; i <= la1; i++)
+            for (k = g->first[j * g->nla + i]; k < g->first[j * g->nla + i + 1]; k++) {
+                dla = (ps + g->idx[k])->la - la;
+                dfi = (ps + g->idx[k])->fi - fi;
+
+                if (dla * dla + dfi * dfi < dm)
+                    push_int(nbr, nnbr, n++, g->idx[k]);
             }
-        } // end if       
-    } // end  1 for                  
+    return (n);
+} // end grid_query
+
+static int point_query(psgrid const * g, nbgraph const * nb, psxys const * ps,
+                       int i, double dm, int ** nbr, int * nnbr)
+{
+    /* indices of points closer to the i-th point than sqrt(dm) [degree],
+     * itself included, taken from the neighbour graph if it is given */
+    int n = 0;
+    long long k;
+    double dla, dfi;
+
+    if (nb == NULL)
+        return (grid_query(g, ps, (ps + i)->la, (ps + i)->fi, dm, nbr, nnbr));
+
+    push_int(nbr, nnbr, n++, i);
+
+    // distances are checked again so the result is the same as with the grid
+    for (k = nb->first[i]; k < nb->first[i + 1]; k++) {
+        dla = (ps + nb->nbr[k])->la - (ps + i)->la;
+        dfi = (ps + nb->nbr[k])->fi - (ps + i)->fi;
 
-    for (i = 0; i < n2; i++) // 2 for
+        if (dla * dla + dfi * dfi < dm)
+            push_int(nbr, nnbr, n++, nb->nbr[k]);
+    }
+    return (n);
+} // end point_query
+
+static int dbscan(psxys const * ps, int n, psgrid const * g,
+                  nbgraph const * nb, double dm, int min_pts, int * label)
+{
+    /* Density based clustering of points, label[i] is the cluster index
+     * of the i-th point or -1 if it is noise. Returns the number of
+     * clusters. A point is a core point if there are at least min_pts
+     * points (itself included) closer than sqrt(dm) [degree]. */
+    int i, j, k, m, ncl = 0, nstack, * stack, * nbr = NULL, nnbr = 0;
+    char * core;
+
+    if ((core = (char * ) malloc((n > 0 ? n : 1) * sizeof(char))) == NULL) {
+        error("\nNot enough memory to allocate core flags\n");
+        exit(1);
+    }
+    if ((stack = (int * ) malloc((n > 0 ? n : 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate DBSCAN stack\n");
+        exit(1);
+    }
+
+    // neighbour counts are independent from each other
+    #pragma omp parallel
     {
-        dla = (indata2 + i)->la - la;
-        dfi = (indata2 + i)->fi - fi;
-        dd = dla * dla + dfi * dfi;
-
-        if (((indata2 + i)->ni > 0) && (dd < dm)) {
-            *(buffer + j) = *(indata2 + i);
-            (indata2 + i)->ni = 0;
-            j++;
-            if (j == *nb) {
-                (*nb) ++;
-                buffer = (psxys *) realloc(buffer, *nb * sizeof(psxys));
+        int ii, * tnbr = NULL, tnnbr = 0;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (ii = 0; ii < n; ii++) {
+            core[ii] = point_query(g, nb, ps, ii, dm, & tnbr, & tnnbr) >= min_pts;
+        }
+        free(tnbr);
+    }
+
+    for (i = 0; i < n; i++) label[i] = -2; // not visited yet
+
+    for (i = 0; i < n; i++) {
+        if (label[i] != -2) continue;
+        
+        if (!core[i]) {
+            label[i] = -1; // noise, may become a border point later
+            continue;
+        }
+
+        label[i] = ncl;
+        stack[0] = i;
+        nstack = 1;
+
+        while (nstack > 0) {
+            j = stack[--nstack];
+            if (!core[j]) continue; // border points are not expanded
+
+            m = point_query(g, nb, ps, j, dm, & nbr, & nnbr);
+
+            for (k = 0; k < m; k++) {
+                if (label[nbr[k]] == -2) {
+                    label[nbr[k]] = ncl;
+                    stack[nstack++] = nbr[k];
+                }
+                else if (label[nbr[k]] == -1)
+                    label[nbr[k]] = ncl;
             }
-        } // end if                               
-    } // end  2 for                  
+        }
+        ncl++;
+    }
+
+    free(nbr);
+    free(stack);
+    free(core);
+
+    return (ncl);
+} // end dbscan
+
+static int cmp_int(void const * a, void const * b)
+{
+    return (* (int const * ) a > * (int const * ) b)
+         - (* (int const * ) a < * (int const * ) b);
+} // end cmp_int
+
+static int cluster(psxys const * indata, int n1, psgrid const * g,
+                   nbgraph const * nb, double dm, char * used, int * k,
+                   int * buffer)
+{
+    /* The first not yet used ascending PS (searched from the k-th one) is
+     * the seed of the cluster, that is formed by the not yet used PSs
+     * closer to the seed than sqrt(dm) [degree]. Indices of the PSs of the
+     * cluster are put into buffer in increasing order, so the ascending
+     * PSs precede the descending ones. */
+    int i, j, m, * nbr = NULL, nnbr = 0;
+
+    while ((* k < n1) && used[* k]) (* k)++; // skip selected PSs
+    
+    if (* k == n1) return (0); // every ascending PS is selected
+
+    m = point_query(g, nb, indata, * k, dm, & nbr, & nnbr);
+
+    for (i = j = 0; i < m; i++) {
+        if (!used[nbr[i]]) {
+            used[nbr[i]] = 1;
+            buffer[j++] = nbr[i];
+        }
+    }
+    free(nbr);
+
+    qsort(buffer, j, sizeof(int), cmp_int);
 
     return (j);
-} // end cluster  
+} // end cluster
+
+static int greedy_clusters(psxys const * indata, int n1, int n2,
+                           psgrid const * g, nbgraph const * nb, double dm,
+                           int ** first, int ** idx)
+{
+    /* Greedy clustering of PSs, the members of the c-th cluster are
+     * (* idx)[(* first)[c]] ... (* idx)[(* first)[c + 1] - 1]. Returns the
+     * number of clusters. */
+    int ncl = 0, nps, k = 0, nfirst = 1024;
+    char * used;
+
+    if ((used = (char * ) calloc(n1 + n2 + 1, sizeof(char))) == NULL ||
+        (* first = (int * ) malloc(nfirst * sizeof(int))) == NULL ||
+        (* idx = (int * ) malloc((n1 + n2 + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate clusters\n");
+        exit(1);
+    }
+
+    (* first)[0] = 0;
+
+    while ((nps = cluster(indata, n1, g, nb, dm, used, & k, * idx + (* first)[ncl])) > 0) {
+        ncl++;
+        if (ncl + 1 == nfirst) {
+            nfirst *= 2;
+            if ((* first = (int * ) realloc(* first, nfirst * sizeof(int))) == NULL) {
+                error("\nNot enough memory to allocate clusters\n");
+                exit(1);
+            }
+        }
+        (* first)[ncl] = (* first)[ncl - 1] + nps;
+    }
+    free(used);
+
+    return (ncl);
+} // end greedy_clusters
+
+static int dbscan_clusters(psxys const * indata, int n, psgrid const * g,
+                           nbgraph const * nb, double dm, int min_pts,
+                           int ** first, int ** idx, int * noise)
+{
+    /* DBSCAN clusters of PSs in the same layout as in greedy_clusters,
+     * the number of noise PSs is stored in noise. */
+    int i, ncl, * label;
+
+    if ((label = (int * ) malloc((n > 0 ? n : 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate labels\n");
+        exit(1);
+    }
+
+    ncl = dbscan(indata, n, g, nb, dm, min_pts, label);
+    
+    // cluster members by counting sort, noise PSs are put in front
+    if ((* first = (int * ) calloc(ncl + 2, sizeof(int))) == NULL ||
+        (* idx = (int * ) malloc((n > 0 ? n : 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate clusters\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++) (* first)[label[i] + 2]++;
+    for (i = 0; i < ncl + 1; i++) (* first)[i + 1] += (* first)[i];
+    
+    // afterwards (* first)[c] is the start of the c-th cluster
+    for (i = 0; i < n; i++) (* idx)[(* first)[label[i] + 1]++] = i;
+    
+    * noise = (* first)[0];
+    free(label);
+
+    return (ncl);
+} // end dbscan_clusters
+
+static void estim_clusters(psxys const * ps, int const * first,
+                           int const * idx, int ncl, psxyd * dom, int * acc)
+{
+    /* Dominant points of clusters given by their member indices, members
+     * of the c-th cluster are idx[first[c]] ... idx[first[c + 1] - 1] in
+     * increasing order. acc[c] is set to 1 if the dominant point of the
+     * cluster is estimated, 0 if the cluster is a hermit (PSs of only one
+     * track) and -1 if the cluster is empty. */
+
+    #pragma omp parallel
+    {
+        int c, i, ps1, ps2, nb = 0;
+        psxys * buffer = NULL;
+
+        #pragma omp for schedule(dynamic, 64)
+        for (c = 0; c < ncl; c++) {
+            ps1 = ps2 = 0;
+
+            for (i = first[c]; i < first[c + 1]; i++) {
+                if ((ps + idx[i])->ni == 1) ps1++;
+                else if ((ps + idx[i])->ni == 2) ps2++;
+            }
+
+            if ((ps1 * ps2) == 0) {
+                acc[c] = (ps1 + ps2) > 0 ? 0 : -1;
+                continue;
+            }
+
+            if (ps1 + ps2 > nb) {
+                nb = ps1 + ps2;
+                if ((buffer = (psxys * ) realloc(buffer, nb * sizeof(psxys))) == NULL) {
+                    error("\nNot enough memory to allocate buffer\n");
+                    exit(1);
+                }
+            }
+
+            // ascending PSs precede descending ones in the buffer
+            for (i = first[c]; i < first[c + 1]; i++)
+                *(buffer + i - first[c]) = *(ps + idx[i]);
+
+            estim_dominant(buffer, ps1, ps2, dom + c);
+            acc[c] = 1;
+        }
+        free(buffer);
+    }
+} // end estim_clusters
+
+static void write_clusters(char * name, char * method, float dam, int min_pts,
+                           double la0, double fi0, psxys const * ps, int n,
+                           int const * first, int const * idx, int ncl,
+                           int const * acc)
+{
+    /* Saves the cluster assignment of the PSs, it is the input of the
+     * dominant_update module. Non empty clusters are numbered in the order
+     * they appear in the dominant file, PSs outside of clusters get -1.
+     * Coordinates are printed with enough digits to read back the same
+     * float values. */
+    int c, i, k, * label;
+    FILE * cl;
+
+    if ((cl = fopen(name, "w+t")) == NULL) {
+        errorln("\n  %s cluster file could not be opened !\n", name);
+        exit(1);
+    }
+    if ((label = (int * ) malloc((n > 0 ? n : 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate labels\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++) label[i] = -1;
+
+    for (c = k = 0; c < ncl; c++) {
+        if (acc[c] < 0) continue;
+        for (i = first[c]; i < first[c + 1]; i++) label[idx[i]] = k;
+        k++;
+    }
+
+    fprintf(cl, "%s %g %d %.15e %.15e %d %d\n", method, dam, min_pts, la0, fi0,
+            k, n);
+
+    for (i = 0; i < n; i++)
+        fprintf(cl, "%d %6d %16.8e %16.8e %16.8e %16.8e\n", (ps + i)->ni,
+                label[i], (ps + i)->la, (ps + i)->fi, (ps + i)->he, (ps + i)->ve);
+
+    free(label);
+    fclose(cl);
+} // end write_clusters
+
+// -----------------------------------------------------------
+
+static unsigned int hash_ps(unsigned int h, float la, float fi)
+{
+    // FNV-1a hash of PS coordinates, the first call should get 2166136261
+
+    size_t i;
+    unsigned char const * b;
+
+    for (i = 0, b = (unsigned char const * ) & la; i < sizeof(float); i++)
+        h = (h ^ b[i]) * 16777619u;
+    for (i = 0, b = (unsigned char const * ) & fi; i < sizeof(float); i++)
+        h = (h ^ b[i]) * 16777619u;
+
+    return (h);
+} // end hash_ps
+
+static void nbg_open(char * name, nbgraph * nb)
+{
+    // memory maps the neighbour graph file written by the neighbours module
+
+    int fd;
+    struct stat st;
+    char * map;
+    nbghead const * head;
+
+    if ((fd = open(name, O_RDONLY)) < 0 || fstat(fd, & st) != 0) {
+        errorln("\n  %s neighbour graph file not found !\n", name);
+        exit(1);
+    }
+
+    map = (char * ) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED || (size_t) st.st_size < sizeof(nbghead)) {
+        errorln("\n  %s neighbour graph file could not be mapped !\n", name);
+        exit(1);
+    }
+
+    head = (nbghead const * ) map;
+
+    if (strncmp(head->magic, "DAISYNBG", 8) != 0 || head->version != 2 ||
+        (unsigned long long) st.st_size
+            != sizeof(nbghead)
+               + (size_t) (head->n1 + head->n2 + 1) * sizeof(long long)
+               + (unsigned long long) head->nnz * sizeof(int)) {
+        errorln("\n  %s is not a valid neighbour graph file !\n", name);
+        exit(1);
+    }
+
+    nb->head = head;
+    nb->first = (long long const * ) (map + sizeof(nbghead));
+    nb->nbr = (int const * ) (nb->first + head->n1 + head->n2 + 1);
+    nb->size = st.st_size;
+} // end nbg_open
+
+static void nbg_close(nbgraph * nb)
+{
+    munmap((void * ) nb->head, nb->size);
+} // end nbg_close
+
+static int nbg_usable(nbgraph const * nb, int n1, int n2, unsigned int hash,
+                      float dam, FILE * lo)
+{
+    // can the neighbour graph be used for the PSs and the separation dam
+
+    if (nb->head->n1 != n1 || nb->head->n2 != n2 || nb->head->hash != hash) {
+        printf("\n Neighbour graph does not match the input files, not used.\n");
+        fprintf(lo, "\n Neighbour graph does not match the input files, not used.\n");
+        return (0);
+    }
+    if (nb->head->radius < dam) {
+        printf("\n Radius of neighbour graph %5.1f (m) is smaller than %5.1f (m), not used.\n",
+               nb->head->radius, dam);
+        fprintf(lo, "\n Radius of neighbour graph %5.1f (m) is smaller than %5.1f (m), not used.\n",
+                nb->head->radius, dam);
+        return (0);
+    }
+
+    printf("\n Neighbour graph is used, radius %5.1f (m)\n", nb->head->radius);
+    fprintf(lo, "\n Neighbour graph is used, radius %5.1f (m)\n", nb->head->radius);
+    return (1);
+} // end nbg_usable
+
+static float text_float(float x)
+{
+    // value of x after it is printed to and read from the selected PS files
+    char buf[32];
+
+    sprintf(buf, "%16.7e", x);
+    sscanf(buf, "%e", & x);
+    return (x);
+} // end text_float
+
+static int select_graph(char * name, float dam, FILE * in1, int ni1,
+                        FILE * in2, int ni2, FILE * ou1, FILE * ou2,
+                        int * n1, int * n2, FILE * lo)
+{
+    /* Selection of adjacent ascending and descending PSs using the
+     * neighbour graph, it gives the same result as the two selectp calls.
+     * Returns 0 if the graph cannot be used. */
+    int i;
+    unsigned int hash = 2166136261u;
+    float la, fi, v, he, dhe, dm = dam / R * C * dam / R * C;
+    char * sel;
+    psxy * ps;
+    nbgraph nb;
+
+    if ((ps = (psxy * ) malloc((ni1 + ni2 + 1) * sizeof(psxy))) == NULL ||
+        (sel = (char * ) calloc(ni1 + ni2 + 1, sizeof(char))) == NULL) {
+        error("\nNot enough memory to allocate PSs\n");
+        exit(1);
+    }
+
+    for (i = 0; i < ni1 + ni2; i++) {
+        fscanf(i < ni1 ? in1 : in2, "%e %e %e %e %e", & la, & fi, & v, & he, & dhe);
+        (ps + i)->la = la;
+        (ps + i)->fi = fi;
+        hash = hash_ps(hash, la, fi);
+    }
+    rewind(in1);
+    rewind(in2);
+
+    nbg_open(name, & nb);
+
+    if (!nbg_usable(& nb, ni1, ni2, hash, dam, lo)) {
+        nbg_close(& nb);
+        free(ps);
+        free(sel);
+        return (0);
+    }
+
+    // ascending PSs that have a descending neighbour
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (i = 0; i < ni1; i++) {
+        long long k;
+        float da;
+
+        for (k = nb.first[i]; k < nb.first[i + 1] && !sel[i]; k++) {
+            if (nb.nbr[k] < ni1) continue;
+            da = ((ps + i)->fi - (ps + nb.nbr[k])->fi) * ((ps + i)->fi - (ps + nb.nbr[k])->fi)
+               + ((ps + i)->la - (ps + nb.nbr[k])->la) * ((ps + i)->la - (ps + nb.nbr[k])->la);
+            sel[i] = (da - dm) <= 0.0;
+        }
+    }
+
+    // selected ascending PSs are read back from text in data_select
+    for (i = 0; i < ni1; i++) {
+        if (!sel[i]) continue;
+        (ps + i)->la = text_float((ps + i)->la);
+        (ps + i)->fi = text_float((ps + i)->fi);
+    }
+
+    // descending PSs that have a selected ascending neighbour
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (i = ni1; i < ni1 + ni2; i++) {
+        long long k;
+        float da;
+
+        for (k = nb.first[i]; k < nb.first[i + 1] && !sel[i]; k++) {
+            if (nb.nbr[k] >= ni1 || !sel[nb.nbr[k]]) continue;
+            da = ((ps + i)->fi - (ps + nb.nbr[k])->fi) * ((ps + i)->fi - (ps + nb.nbr[k])->fi)
+               + ((ps + i)->la - (ps + nb.nbr[k])->la) * ((ps + i)->la - (ps + nb.nbr[k])->la);
+            sel[i] = (da - dm) <= 0.0;
+        }
+    }
+    nbg_close(& nb);
+
+    * n1 = * n2 = 0;
+    for (i = 0; i < ni1 + ni2; i++) {
+        fscanf(i < ni1 ? in1 : in2, "%e %e %e %e %e", & la, & fi, & v, & he, & dhe);
+        if (!sel[i]) continue;
+
+        fprintf(i < ni1 ? ou1 : ou2, "%16.7e %16.7e %16.7e %16.7e %16.7e\n",
+                la, fi, v, he, dhe);
+        if (i < ni1) (* n1)++;
+        else (* n2)++;
+    }
+
+    free(ps);
+    free(sel);
+    return (1);
+} // end select_graph
+  
 
 static void axd(double a1, double a2, double a3,
                 double d1, double d2, double d3,
@@ -407,307 +1103,461 @@ static void azim_elev(station ps, station sat, double * azi, double * inc)
 
 // -----------------------------------------------------------
 
-static void closest_appr(double * poli, int pd, double tfp, double tlp,
-                         station * ps, station * sat)
+static int closest_appr(orbit_poly const * orb, station * ps, station * sat,
+                        double * t, double tol, int max_iter)
 {
-    // compute the sat position using closest approache
-    double tf, tl, tm; // first, last and middle time
-    double vs, ve, vm; // vectorial products
-    double vxs, vys, vzs; // sat velocities
-    double lvs, lps; // vector length
+    // compute the sat position using closest approache, Newton steps on
+    // the Doppler of the orbit starting from *t (NAN: middle of the orbit),
+    // *t is the zero-Doppler time on return; returns the number of
+    // iterations
+    double point[3], pos[3];
+    int iter;
+
+    point[0] = ps->x;
+    point[1] = ps->y;
+    point[2] = ps->z;
+
+    iter = orbit_zero_doppler(orb, point, 0.0, orb->t1 - orb->t0, tol,
+                              max_iter, t, pos);
+
+    if (iter < 0) {
+        errorln("\n Error - no closest approache within %d iterations for"
+                " point %.6f %.6f !\n", max_iter, ps->l / M_PI * 180.0,
+                ps->f / M_PI * 180.0);
+        exit(1);
+    }
 
-    double dx, dy, dz;
+    sat->x = pos[0];
+    sat->y = pos[1];
+    sat->z = pos[2];
 
-    int i, itr;
+    return iter;
+} // end closest_appr
 
-    tf = tfp - tfp;
-    tl = tlp - tfp;
+static long closest_appr_batch(orbit_poly const * orb, int m,
+                               double const * xyz, double * t, double * sat,
+                               double tol, int max_iter)
+{
+    // closest approache of m <= orbit_lanes points given as x, y, z rows,
+    // starting from t (NAN: middle of the orbit), t and sat are the
+    // zero-Doppler times and satellite positions on return; returns the
+    // total number of iterations
+    int j, iter[orbit_lanes];
+    long sum = 0;
+
+    if (orbit_zero_doppler_batch(orb, m, xyz, 0.0, orb->t1 - orb->t0, tol,
+                                 max_iter, t, sat, NULL, iter) > 0) {
+        errorln("\n Error - no closest approache within %d iterations !\n",
+                max_iter);
+        exit(1);
+    }
 
-    // first S1 position 
+    for (j = 0; j < m; j++) sum += iter[j];
 
-    sat->x = sat->y = sat->z = vxs = vys = vzs = 0.0;
+    return sum;
+} // end closest_appr_batch
 
-    for (i = 0; i < pd; i++) {
-        sat->x += *(poli + i) * pow(tf, 1.0 * i);
-        sat->y += *(poli + pd + i) * pow(tf, 1.0 * i);
-        sat->z += *(poli + 2 * pd + i) * pow(tf, 1.0 * i);
-    }
-    
-    dx = sat->x - ps->x;
-    dy = sat->y - ps->y;
-    dz = sat->z - ps->z;
-    
-    lps = distance(dx, dy, dz);
+static void azimuth_model(orbit_poly const * orb, azmodel * m)
+{
+    // state vector in the middle of the orbit
+    double pos[3], vel[3], acc[3];
 
-    for (i = 1; i < pd; i++) {
-        vxs += i * *(poli + i) * pow(tf, 1.0 * (i - 1));
-        vys += i * * (poli + pd + i) * pow(tf, 1.0 * (i - 1));
-        vzs += i * * (poli + 2 * pd + i) * pow(tf, 1.0 * (i - 1));
-    }
-    
-    lvs = distance(vxs, vys, vzs);
+    m->t = (orb->t1 - orb->t0) / 2.0;
+    orbit_eval(orb, m->t, pos, vel, acc);
 
-    vs =   vxs / lvs * dx / lps
-         + vys / lvs * dy / lps 
-         + vzs / lvs * dz / lps;
+    m->x = pos[0]; m->y = pos[1]; m->z = pos[2];
+    m->vx = vel[0]; m->vy = vel[1]; m->vz = vel[2];
+    m->ax = acc[0]; m->ay = acc[1]; m->az = acc[2];
+    m->vv = vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2];
+} // end azimuth_model
 
-    // last S1 position 
-    sat->x = sat->y = sat->z = vxs = vys = vzs = 0.0;
+static double azimuth_time(azmodel const * m, station const * ps)
+{
+    // approximate zero-Doppler time of ps
+    double dx = ps->x - m->x, dy = ps->y - m->y, dz = ps->z - m->z;
 
-    for (i = 0; i < pd; i++) {
-        sat->x += *(poli + i) * pow(tl, 1.0 * i);
-        sat->y += *(poli + pd + i) * pow(tl, 1.0 * i);
-        sat->z += *(poli + 2 * pd + i) * pow(tl, 1.0 * i);
-    }
-    
-    dx = sat->x - ps->x;
-    dy = sat->y - ps->y;
-    dz = sat->z - ps->z;
-    
-    lps = distance(dx, dy, dz);
+    return m->t + (m->vx * dx + m->vy * dy + m->vz * dz)
+                  / (m->vv - m->ax * dx - m->ay * dy - m->az * dz);
+} // end azimuth_time
 
-    for (i = 1; i < pd; i++) {
-        vxs += i * *(poli + i) * pow(tl, 1.0 * (i - 1));
-        vys += i * *(poli + pd + i) * pow(tl, 1.0 * (i - 1));
-        vzs += i * *(poli + 2 * pd + i) * pow(tl, 1.0 * (i - 1));
-    }
+static int cmp_time(void const * a, void const * b)
+{
+    // increasing time, increasing index for equal times
+    pstime const * aa = (pstime const * ) a, * bb = (pstime const * ) b;
+
+    if (aa->t < bb->t) return (-1);
+    if (aa->t > bb->t) return (1);
+    return ((aa->i > bb->i) - (aa->i < bb->i));
+} // end cmp_time
+
+static void poly_fit(int m, int u, torb * orb, int kind, double * X,
+                     double * mu0, double * sd)
+{
+    // o(t) = a0 + a1*t + a2*t^2 + a3*t^3  + ... 
+    // or o(t) = a0 + a1*T1(tau) + a2*T2(tau) + ... (Chebyshev)
+    // x, y and z are fitted together, see satorbit/orbit.cpp
     
-    lvs = distance(vxs, vys, vzs);
+    int ret = kind == orbit_chebyshev
+              ? orbit_cheb_fit(m, u - 1, (double *) orb, X, mu0, sd)
+              : orbit_poly_fit(m, u - 1, (double *) orb, X, mu0, sd);
+    
+    if (ret == 1) {
+        errorln("\n Error - at least %d orbit records are required ! \n",
+                u + 1);
+        exit(1);
+    }
+    if (ret == 3) {
+        error("\n Error - orbit records are not in increasing time order ! \n");
+        exit(1);
+    }
+    if (ret != 0) {
+        error("\n Error - singular normal matrix ! \n");
+        exit(0);
+    }
+} // end poly_fit
 
-    ve =   vxs / lvs * dx / lps
-         + vys / lvs * dy / lps
-         + vzs / lvs * dz / lps;
+static void spline_fit(int m, int deg, int nseg, torb * orb, double * X,
+                       double * mu0)
+{
+    // piecewise polynomials with uniform segments, see satorbit/orbit.cpp
+    
+    int ret = orbit_spline_fit(m, deg, nseg, (double *) orb, X, mu0);
+    
+    if (ret == 1) {
+        errorln("\n Error - at least %d orbit records are required ! \n",
+                nseg + deg + 1);
+        exit(1);
+    }
+    if (ret == 3) {
+        error("\n Error - orbit records are not in increasing time order ! \n");
+        exit(1);
+    }
+    if (ret != 0) {
+        error("\n Error - too many spline segments for the orbit records ! \n");
+        exit(1);
+    }
+} // end spline_fit
 
-    itr = 0;
-    do {
-        tm = (tf + tl) / 2.0;
+static void print_fit(int m, int u, double const * X, double mu0,
+                      double const * sd, FILE * lo)
+{
+    int j;
+    
+    fprintf(lo, "  mu0= %8.4lf dof= %d", mu0, m - u);
+    //   fprintf(lo,"\n\n         coefficients                  std\n");
 
-        //     middle S1 position 
-        sat->x = sat->y = sat->z = vxs = vys = vzs = 0.0;
+    printf("\n\n mu0= %8.4lf", mu0);
+    printf("     dof= %d", m - u);
+    printf("\n\n         coefficients                  std\n");
 
-        for (i = 0; i < pd; i++) {
-            sat->x += *(poli + i) * pow(tm, 1.0 * i);
-            sat->y += *(poli + pd + i) * pow(tm, 1.0 * i);
-            sat->z += *(poli + 2 * pd + i) * pow(tm, 1.0 * i);
-        }
-        
-        dx = sat->x - ps->x;
-        dy = sat->y - ps->y;
-        dz = sat->z - ps->z;
-        
-        lps = distance(dx, dy, dz);
+    for (j = 0; j < u; j++) {
+        printf("\n%2d %23.15e   %23.15e", j, *(X + j), *(sd + j));
+        //  fprintf(lo,"\n%2d %23.15e   %23.15e",j, *(X+j), *(sd+j));
+    }
+} // end print_fit
 
-        for (i = 1; i < pd; i++) {
-            vxs += i * *(poli + i) * pow(tm, 1.0 * (i - 1));
-            vys += i * *(poli + pd + i) * pow(tm, 1.0 * (i - 1));
-            vzs += i * *(poli + 2 * pd + i) * pow(tm, 1.0 * (i - 1));
-        }
-        
-        lvs = distance(vxs, vys, vzs);
+// -------------------------------------------------
 
-        vm =   vxs / lvs * dx / lps
-             + vys / lvs * dy / lps
-             + vzs / lvs * dz / lps;
+static void change_ext(char * name, char * ext) {
+    // change the extent of name for ext
 
-        if ((vs * vm) > 0.0) {
-            tf = tm;
-            vs = vm;
-        } // change start for middle 
-        else {
-            tl = tm;
-            ve = vm;
-        } // change  end  for middle
+    int i = 0;
+    while ( *(name + i) != '.' && *(name + i) != '\0') i++;
+    *(name + i) = '\0';
 
-        itr++;
+    strcat(name, ".");
+    strcat(name, ext);
 
-    } while (fabs(vm) > 1.0e-11);
-} // end closest_appr
+} // end change_ext
 
-static int plc(int i, int j, int n) {
-    // position of i-th, j-th element  0
-    // in the lower triangle           1 2
-    // stored in vector                3 4 5 
+static int clip_crossings(pgclip const * pg, int j, double la, double fi)
+{
+    // crossing number test with the edges of the j-th latitude band
+    int k, c = 0;
+    double const * x0 = pg->x0, * y0 = pg->y0, * y1 = pg->y1, * dxdy = pg->dxdy;
 
-    int k, l;
-    k = (i < j) ? i + 1 : j + 1;
-    l = (i > j) ? i + 1 : j + 1;
-    return ((l - 1) * l / 2 + k - 1);
-} // end plc
+    #pragma omp simd reduction(^:c)
+    for (k = pg->first[j]; k < pg->first[j + 1]; k++)
+        c ^= ((y0[k] > fi) != (y1[k] > fi)) & (la < x0[k] + (fi - y0[k]) * dxdy[k]);
 
-static int chole(double * q, int n) {
-    // Cholesky decomposition of
-    // symmetric positive definit
-    // normal matrix
+    return (c);
+} // end clip_crossings
 
-    int i, j, k, l, ia, l1;
-    double a, sqr, sum;
+static int clip_inside(pgclip const * pg, double la, double fi)
+{
+    // is the point (la, fi) inside the polygons (even-odd rule)
+    int i, j;
 
-    for (i = 0; i < n; i++) {
-        a = *(q + plc(i, i, n));
+    i = (int) floor((la - pg->la0) / pg->cell);
+    j = (int) floor((fi - pg->fi0) / pg->cell);
 
-        if (a <= 0.0) return (1);
-        sqr = sqrt(a);
-        for (k = i; k < n; k++) *(q + plc(i, k, n)) /= sqr;
-        
-        l = i + 1;
-        if (l == n) goto end1;
-        
-        for (j = l; j < n; j++)
-            for (k = j; k < n; k++)
-                *(q + plc(j, k, n)) -= *(q + plc(i, j, n)) * *(q + plc(i, k, n));
-    }
-    end1:
-        for (i = 0; i < n; i++) {
-            ia = plc(i, i, n); *(q + ia) = 1.0 / *(q + ia);
-            l1 = i + 1;
-            if (l1 == n) goto end2;
-            for (j = l1; j < n; j++) {
-                sum = 0.0;
-                for (k = i; k < j; k++)
-                    sum += *(q + plc(i, k, n)) * *(q + plc(k, j, n));
-                *(q + plc(i, j, n)) = -sum / *(q + plc(j, j, n));
-            }
-        }
-    end2:
-        for (i = 0; i < n; i++)
-            for (k = i; k < n; k++) {
-                sum = 0.0;
-                for (j = k; j < n; j++)
-                    sum += * (q + plc(i, j, n)) * * (q + plc(k, j, n));
-                *(q + plc(i, k, n)) = sum;
-            }
+    if (i < 0 || j < 0 || i >= pg->nla || j >= pg->nfi) return (0);
+    if (pg->state[j * pg->nla + i] < 2) return (pg->state[j * pg->nla + i]);
 
-    return (0);
-} // end chole
+    return (clip_crossings(pg, j, la, fi));
+} // end clip_inside
 
-static void ATA_ATL(int m, int u, double * A, double * L, double * ATA,
-                    double * ATL)
+static void clip_build(pgclip * pg, double const * vla, double const * vfi,
+                       int const * ring, int nring)
 {
-    // m - number of measurements
-    // u - number of unknowns
-
-    int i, j, k, l;
-    double *buf;
+    /* vertices of the k-th ring are ring[k] ... ring[k + 1] - 1,
+     * rings are closed automatically */
+    int i, j, k, l, m, nv = ring[nring], ne, la0, la1, fi0, fi1, * cnt;
+    double xa, ya, xb, yb, la1d, fi1d;
+
+    pg->la0 = la1d = vla[0];
+    pg->fi0 = fi1d = vfi[0];
+    for (i = 1; i < nv; i++) {
+        if (vla[i] < pg->la0) pg->la0 = vla[i];
+        if (vla[i] > la1d)    la1d    = vla[i];
+        if (vfi[i] < pg->fi0) pg->fi0 = vfi[i];
+        if (vfi[i] > fi1d)    fi1d    = vfi[i];
+    }
 
-    if ((buf = (double * ) malloc(m * sizeof(double))) == NULL) {
-        error("\n Not enough memory to allocate BUF \n");
+    // 2 sqrt(nv) cells along the longer side, at most 4096
+    ne = (int) ceil(2.0 * sqrt((double) nv)) + 1;
+    if (ne > 4096) ne = 4096;
+    pg->cell = ((la1d - pg->la0) > (fi1d - pg->fi0) ? la1d - pg->la0 : fi1d - pg->fi0) / ne;
+    if (pg->cell <= 0.0) pg->cell = 1.0e-9;
+    pg->nla = (int) ((la1d - pg->la0) / pg->cell) + 1;
+    pg->nfi = (int) ((fi1d - pg->fi0) / pg->cell) + 1;
+
+    if ((pg->state = (char * ) calloc((size_t) pg->nla * pg->nfi, sizeof(char))) == NULL ||
+        (pg->first = (int * ) calloc(pg->nfi + 1, sizeof(int))) == NULL ||
+        (cnt = (int * ) calloc(pg->nfi + 1, sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate polygon grid\n");
         exit(1);
     }
 
-    for (i = 0; i < u; i++) // row of ATPA
-    {
-        // buffer +++++++++++++++++++++++++++++++++
-        for (k = 0; k < m; k++) {
-            *(buf + k) = 0.0;
-            for (l = 0; l < m; l++)
-                *(buf + k) = * (buf + k) + * (A + l * u + i);
-        }
-        // buffer +++++++++++++++++++++++++++++++++
-        for (l = 0; l < m; l++)
-            *(ATL + i) = *(ATL + i) + *(buf + l) * *(L + l);
-        
-        // column of ATPA
-        for (j = i; j < u; j++) {
-            k = plc(i, j, u);
-            for (l = 0; l < m; l++)
-                *(ATA + k) = *(ATA + k) + *(buf + l) * *(A + l * u + j);
-        } // end - column of ATPA
-    } // end - row of ATPA
-    free(buf);
+    // two passes over the edges: counting, then storing them into bands
+    for (m = 0; m < 2; m++) {
+        for (k = 0; k < nring; k++)
+            for (l = ring[k]; l < ring[k + 1]; l++) {
+                xa = vla[l];
+                ya = vfi[l];
+                xb = vla[l + 1 < ring[k + 1] ? l + 1 : ring[k]];
+                yb = vfi[l + 1 < ring[k + 1] ? l + 1 : ring[k]];
+
+                la0 = (int) floor(((xa < xb ? xa : xb) - pg->la0) / pg->cell);
+                la1 = (int) floor(((xa < xb ? xb : xa) - pg->la0) / pg->cell);
+                fi0 = (int) floor(((ya < yb ? ya : yb) - pg->fi0) / pg->cell);
+                fi1 = (int) floor(((ya < yb ? yb : ya) - pg->fi0) / pg->cell);
+                if (la1 >= pg->nla) la1 = pg->nla - 1;
+                if (fi1 >= pg->nfi) fi1 = pg->nfi - 1;
+
+                for (j = fi0; j <= fi1; j++) {
+                    if (m == 0) {
+                        for (i = la0; i <= la1; i++) pg->state[j * pg->nla + i] = 2;
+                        // horizontal edges are never crossed
+                        if (ya != yb) pg->first[j + 1]++;
+                    } else if (ya != yb) {
+                        i = pg->first[j] + cnt[j]++;
+                        pg->x0[i] = xa;
+                        pg->y0[i] = ya;
+                        pg->y1[i] = yb;
+                        pg->dxdy[i] = (xb - xa) / (yb - ya);
+                    }
+                }
+            }
 
-} // end ATA_ATL
+        if (m == 0) {
+            for (j = 0; j < pg->nfi; j++) pg->first[j + 1] += pg->first[j];
+            ne = pg->first[pg->nfi];
 
-static int poly_fit(int m, int u, torb * orb, double * X, char c, FILE * lo)
+            if ((pg->x0 = (double * ) malloc((ne + 1) * sizeof(double))) == NULL ||
+                (pg->y0 = (double * ) malloc((ne + 1) * sizeof(double))) == NULL ||
+                (pg->y1 = (double * ) malloc((ne + 1) * sizeof(double))) == NULL ||
+                (pg->dxdy = (double * ) malloc((ne + 1) * sizeof(double))) == NULL) {
+                error("\nNot enough memory to allocate polygon edges\n");
+                exit(1);
+            }
+        }
+    }
+    free(cnt);
+
+    // cells without edges are inside or outside as their centres
+    #pragma omp parallel for private(i)
+    for (j = 0; j < pg->nfi; j++)
+        for (i = 0; i < pg->nla; i++)
+            if (pg->state[j * pg->nla + i] != 2)
+                pg->state[j * pg->nla + i] = clip_crossings(pg, j,
+                                             pg->la0 + (i + 0.5) * pg->cell,
+                                             pg->fi0 + (j + 0.5) * pg->cell);
+} // end clip_build
+
+static void clip_free(pgclip * pg)
 {
-    // o(t) = a0 + a1*t + a2*t^2 + a3*t^3  + ... 
-    int i, j;
-    double t, * A, * L, * ATA, * ATL, mu0 = 0.0;
-
-    if ((A = (double * ) malloc(u * sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate A\n");
+    free(pg->state);
+    free(pg->first);
+    free(pg->x0);
+    free(pg->y0);
+    free(pg->y1);
+    free(pg->dxdy);
+} // end clip_free
+
+static void read_porb(char * name, orbit_poly * orb)
+{
+    // reads a polynomial orbit file written by poly_orbit, the first line
+    // is the degree, optionally followed by the kind of the polynomials
+    // and, for splines, the number of segments; binary orbit caches are
+    // mapped as they are
+    int i, j, deg, nseg = 1;
+    char line[80], kind[16] = "";
+    FILE * in;
+
+    if (orbit_cache_open(name, orb, NULL) == 0)
+        return;
+
+    if ((in = fopen(name, "rt")) == NULL) {
+        errorln("\n  %s data file not found !", name);
         exit(1);
     }
-    if ((ATA = (double * ) calloc(u * (u + 1) / 2, sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate ATA\n");
+
+    if (fgets(line, 80, in) == NULL
+        || sscanf(line, "%d %15s %d", & deg, kind, & nseg) < 1) {
+        errorln("\n  %s is not a polynomial orbit file !", name);
         exit(1);
     }
-    if ((ATL = (double * ) calloc(u, sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate ATL\n");
+
+    if (kind[0] == '\0' || Str_IsEqual(kind, "monomial"))
+        orb->kind = orbit_monomial;
+    else if (Str_IsEqual(kind, "chebyshev"))
+        orb->kind = orbit_chebyshev;
+    else if (Str_IsEqual(kind, "spline") && nseg > 0)
+        orb->kind = orbit_spline;
+    else {
+        errorln("\n  Unknown orbit polynomial %s in %s !", kind, name);
         exit(1);
     }
-    if ((L = (double * ) calloc(1, sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate L\n");
+
+    orb->n = deg + 1;
+    orb->nseg = orb->kind == orbit_spline ? nseg : 1;
+    orb->map = NULL;
+    fscanf(in, "%lf %lf", & orb->t0, & orb->t1);
+
+    if ((orb->coeffs = (double * ) malloc(orb->n * orb->nseg * 3
+                                          * sizeof(double))) == NULL
+        || (orb->dcoeffs = (double * ) malloc(orb->n * orb->nseg * 6
+                                              * sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate orbit polynomials\n");
         exit(1);
     }
+    // spline segments follow each other for every coordinate
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < orb->n * orb->nseg; j++)
+            fscanf(in, " %lf", orb->coeffs + i * orb->n * orb->nseg + j);
+    fclose(in);
 
-    for (i = 0; i < m; i++) {
-        if (c == 'x') * L = (orb + i)->x;
-        else if (c == 'y') * L = (orb + i)->y;
-        else if (c == 'z') * L = (orb + i)->z;
-        t = (orb + i)->t - orb->t;
-        for (j = 0; j < u; j++) * (A + j) = pow(t, 1.0 * j);
-        ATA_ATL(1, u, A, L, ATA, ATL);
-    }
-    if (chole(ATA, u) != 0) {
-        error("\n Error - singular normal matrix ! \n");
-        exit(0);
-    }
-    
-    // update of unknowns
-    for (i = 0; i < u; i++) {
-        *(X + i) = 0.0;
-        for (j = 0; j < u; j++)
-            *(X + i) = *(X + i) + *(ATA + plc(i, j, u)) * *(ATL + j);
+    // velocity and acceleration coefficients once instead of per epoch
+    orbit_derivatives(orb, orb->dcoeffs);
+} // end read_porb
+
+static void free_porb(orbit_poly * orb)
+{
+    if (orb->map != NULL)
+        orbit_cache_close(orb);
+    else {
+        free(orb->coeffs);
+        free(orb->dcoeffs);
     }
+} // end free_porb
+
+static void collect_orbits(char const * path, char *** files, int * n,
+                           int * cap)
+{
+    // path itself or the .res and .par files of a directory tree
 
-    for (i = 0; i < m; i++) {
-        if (c == 'x') * L = -(orb + i)->x;
-        else if (c == 'y') * L = -(orb + i)->y;
-        else if (c == 'z') * L = -(orb + i)->z;
-        t = (orb + i)->t - orb->t;
+    struct stat st;
+    DIR * dir;
+    struct dirent * de;
+    char * name;
+    size_t len;
 
-        for (j = 0; j < u; j++)
-            *L += *(X + j) * pow(t, 1.0 * j);
-        mu0 += *L * *L;
+    if (stat(path, & st) != 0) {
+        errorln("\n  %s not found !", path);
+        exit(1);
     }
-    mu0 = sqrt(mu0 / (m - u) * 1.0);
 
-    fprintf(lo, "  mu0= %8.4lf dof= %d", mu0, m - u);
-    //   fprintf(lo,"\n\n         coefficients                  std\n");
+    if (S_ISDIR(st.st_mode)) {
+        if ((dir = opendir(path)) == NULL) {
+            errorln("\n  Cannot read directory %s !", path);
+            exit(1);
+        }
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] == '.') continue;
 
-    printf("\n\n mu0= %8.4lf", mu0);
-    printf("     dof= %d", m - u);
-    printf("\n\n         coefficients                  std\n");
+            if ((name = (char * ) malloc(strlen(path) + strlen(de->d_name)
+                                         + 2)) == NULL) {
+                error("\nNot enough memory to allocate file names\n");
+                exit(1);
+            }
+            sprintf(name, "%s/%s", path, de->d_name);
+            len = strlen(name);
 
-    for (j = 0; j < u; j++) {
-        printf("\n%2d %23.15e   %23.15e", j,
-                *(X + j), mu0 * sqrt( *(ATA + plc(j, j, u))));
-        //  fprintf(lo,"\n%2d %23.15e   %23.15e",j, *(X+j), mu0*sqrt( *(ATA+plc(j,j,u)) ));
+            if (stat(name, & st) == 0 && S_ISDIR(st.st_mode)) {
+                collect_orbits(name, files, n, cap);
+                free(name);
+            }
+            else if (len > 4 && (Str_IsEqual(name + len - 4, ".res")
+                                 || Str_IsEqual(name + len - 4, ".par"))) {
+                collect_orbits(name, files, n, cap);
+                free(name);
+            }
+            else
+                free(name);
+        }
+        closedir(dir);
+        return;
     }
 
-    return (1);
-} // end poly_fit
+    if (* n == * cap) {
+        * cap = * cap ? 2 * * cap : 64;
+        if ((* files = (char * * ) realloc(* files, * cap * sizeof(char * )))
+            == NULL) {
+            error("\nNot enough memory to allocate file names\n");
+            exit(1);
+        }
+    }
+    if (((* files)[* n] = (char * ) malloc(strlen(path) + 1)) == NULL) {
+        error("\nNot enough memory to allocate file names\n");
+        exit(1);
+    }
+    strcpy((* files)[(* n)++], path);
+} // end collect_orbits
 
-// -------------------------------------------------
+static char * get_option(int argc, char * argv[], char * name)
+{
+    // value of the optional "--name=value" argument, NULL if not given
 
-static void change_ext(char * name, char * ext) {
-    // change the extent of name for ext
+    int i, len = strlen(name);
 
-    int i = 0;
-    while ( *(name + i) != '.' && *(name + i) != '\0') i++;
-    *(name + i) = '\0';
+    for (i = Minarg; i < argc; i++)
+        if (strncmp(argv[i], name, len) == 0 && argv[i][len] == '=')
+            return (argv[i] + len + 1);
 
-    sprintf(name, "%s.%s", name, ext);
+    return (NULL);
+} // end get_option
 
-} // end change_ext
+static int get_flag(int argc, char * argv[], char * name)
+{
+    // is the optional "--name" switch given
+
+    int i;
+
+    for (i = Minarg; i < argc; i++)
+        if (Str_IsEqual(argv[i], name)) return (1);
+
+    return (0);
+} // end get_flag
 
 /****************
  * Main modules *
  ****************/
 
 int data_select(int argc, char * argv[]) {
-    int i, n, ni1, ni2;
+    int i, n, n2, ni1, ni2;
     psxy * indata;
+    char * graph; // neighbour graph file
 
     char * inp1; // ASC input file
     char * inp2; // DSC input file     
@@ -740,6 +1590,10 @@ int data_select(int argc, char * argv[]) {
                 \n           asc_data.xy  - (1st) ascending  data file\
                 \n           dsc_data.xy  - (2nd) descending data file\
                 \n           100          - (3rd) PSs separation (m)\n\
+                \n   options:\
+                \n           --graph=asc_data.xy.nbg - neighbour graph written\
+                \n                          by the neighbours module for\
+                \n                          the same input files\n\
                 \n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
         exit(1);
     }
@@ -793,6 +1647,25 @@ int data_select(int argc, char * argv[]) {
     while (fscanf(in2, "%e %e %e %e %e", & la, & fi, & v, & he, & dhe) > 0) ni2++;
     rewind(in2);
 
+    if ((graph = get_option(argc, argv, "--graph")) != NULL &&
+        select_graph(graph, dam, in1, ni1, in2, ni2, ou1, ou2, & n, & n2, log)) {
+
+        printf("\n\n %s  PSs %d\n", argv[2], ni1);
+        fprintf(log, "\n\n %s  PSs %d", argv[2], ni1);
+        printf("\n\n %s PSs %d\n", out1, n);
+        fprintf(log, "\n %s PSs %d", out1, n);
+
+        printf("\n\n %s  PSs %d\n", argv[3], ni2);
+        fprintf(log, "\n\n %s  PSs %d", argv[3], ni2);
+        printf("\n\n %s PSs %d\n", out2, n2);
+        fprintf(log, "\n %s PSs %d\n\n", out2, n2);
+
+        printf("\n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+                \n +                  END DATA_SELECT                   +\
+                \n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        return (0);
+    }
+
     //  Copy data to memory 
     if ((indata = (psxy * ) malloc(ni2 * sizeof(psxy))) == NULL) {
         printf("\nNot enough memory to allocate indata 1");
@@ -852,43 +1725,51 @@ int data_select(int argc, char * argv[]) {
 
     } // end data_select
 
-int dominant(int argc, char * argv[]) {
-    int i, n1, n2,  // number of data in input files
-        nb = 2,     // starting number of data in cluster buffer, continiusly updated
-        nc,         // number of preselected clusters 
-        nsc,        // number of selected clusters 
-        nhc,        // number of hermit clusters             
-        nps,        // number of selected PSs in actual cluster
-        ps1,        // number of PSs from 1 input file
-        ps2;        // number of PSs from 2 input file 
+int neighbours(int argc, char * argv[]) {
+    int i, n1, n2, n, nbr_max;
+    long long nnz, * first;
+    int * nbr;
+    psxys * ps;
+    psgrid grid;
+    nbghead head;
 
-    psxys *indata1, *indata2, *buffer; // names of allocated memories
-    char *out = "dominant.xyd", // output file 
-         *log = "dominant.log"; // log output file
+    char * out, * logf = "neighbours.log";
+    FILE * in1, * in2, * ou, * lo;
 
-    FILE *in1, *in2, *ou, *lo;
+    float dam, la, fi, ve, he, dhe;
+    double dm;
 
-    float dam, la, fi, he, dhe, ve;
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                    NEIGHBOURS                       +\
+            \n +  neighbour graph of ascending and descending PSs    +\
+            \n +  is saved for data_select and dominant              +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
 
-    //  printf("argc: %d\n",argc);  
-    //  printf("%s\n",argv[0]);
-    //  printf("%s\n",argv[1]);  
-    //  printf("%s\n",argv[2]);    
+    if (argc - Minarg < 3) {
+        printf("\n   usage:  daisy neighbours asc_data.xy dsc_data.xy 500  \n\
+                \n           asc_data.xy  - (1st) ascending  data file\
+                \n           dsc_data.xy  - (2nd) descending data file\
+                \n           500          - (3rd) radius of neighbourhood (m)\n\
+                \n           output: asc_data.xy.nbg, it can be used for\
+                \n           separations not larger than the radius\
+                \n           and only for the same input PSs: any change,\
+                \n           e.g. a delta of dominant_update, invalidates\
+                \n           the whole graph, run neighbours again\n\
+                \n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
 
-    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
-            \n +                        DOMINANT                       +\
-            \n + clusters of ascending and descending PSs are selected +\
-            \n +     and the dominant points (DSs) are estimated       +\
-            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+    if ((lo = fopen(logf, "w+t")) == NULL) {
+        error("\n  LOG file not found !\n");
+        exit(1);
+    }
+    fprintf(lo, "\n %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3], argv[4]);
 
-    if (argc - Minarg < 3) {
-        printf("\n    usage:  daisy dominant asc_data.xys dsc_data.xys 100\n\
-                \n            asc_data.xys   - (1st) ascending  data file\
-                \n            dsc_data.xys   - (2nd) descending data file\
-                \n            100            - (3rd) cluster separation (m)\n\
-                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+    if ((out = (char * ) malloc((strlen(argv[2]) + 5) * sizeof(char))) == NULL) {
+        error("\n Not enough memory to allocate OUT\n");
         exit(1);
     }
+    sprintf(out, "%s.nbg", argv[2]);
 
     if ((in1 = fopen(argv[2], "rt")) == NULL) {
         error("\n  ASC data file not found !\n");
@@ -898,141 +1779,1462 @@ int dominant(int argc, char * argv[]) {
         error("\n  DSC data file not found !\n");
         exit(1);
     }
-    if ((ou = fopen(out, "w+t")) == NULL) {
-        error("\n  OUT data file not found !\n");
-        exit(1);
-    }
-    if ((lo = fopen(log, "w+t")) == NULL) {
-        error("\n  LOG data file not found !\n");
-        exit(1);
-    }
-
-    fprintf(lo, "\n %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3], argv[4]);
 
-    printf("\n  input: %s\n         %s\n", argv[2], argv[3]);
-    printf("\n output: %s\n\n", out);
-    fprintf(lo, "\n  input: %s\n         %s\n", argv[2], argv[3]);
-    fprintf(lo, "\n output: %s\n\n", out);
-
-    //------------------------------------------------------
     sscanf(argv[4], "%f", & dam);
-    printf("\n Appr. cluster size %5.1f (m)\n", dam);
-    fprintf(lo, "\n Appr. cluster size %5.1f (m)\n\n", dam);
-    // -----------------------------------------------------
 
-    printf("\n Copy data to memory ...\n");
-    
+    printf("\n  input: %s\n         %s\n output: %s\n", argv[2], argv[3], out);
+    fprintf(lo, "\n  input: %s\n         %s\n output: %s\n", argv[2], argv[3], out);
+    printf("\n Radius of neighbourhood %5.1f (m)\n", dam);
+    fprintf(lo, "\n Radius of neighbourhood %5.1f (m)\n", dam);
+
     n1 = 0;
     while (fscanf(in1, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n1++;
     rewind(in1);
 
-    if ((indata1 = (psxys * ) malloc(n1 * sizeof(psxys))) == NULL) {
-        error("\nNot enough memory to allocate indata 1\n");
-        exit(1);
-    }
-    for (i = 0; i < n1; i++) {
-        fscanf(in1, "%e %e %e %e %e", &la, &fi, &ve, &he, &dhe);
-        (indata1 + i)->ni = 1;
-        (indata1 + i)->la = la;
-        (indata1 + i)->fi = fi;
-        (indata1 + i)->he = he + dhe;
-        (indata1 + i)->ve = ve;
-    }
-    fclose(in1);
-
     n2 = 0;
     while (fscanf(in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n2++;
     rewind(in2);
 
-    if ((indata2 = (psxys * ) malloc(n2 * sizeof(psxys))) == NULL) {
-        error("\nNot enough memory to allocate indata 2\n");
+    n = n1 + n2;
+
+    if ((ps = (psxys * ) malloc((n + 1) * sizeof(psxys))) == NULL ||
+        (first = (long long * ) malloc((n + 1) * sizeof(long long))) == NULL) {
+        error("\nNot enough memory to allocate PSs\n");
         exit(1);
     }
-    for (i = 0; i < n2; i++) {
-        fscanf(in2, "%e %e %e %e %e", &la, &fi, &ve, &he, &dhe);
-        (indata2 + i)->ni = 2;
-        (indata2 + i)->la = la;
-        (indata2 + i)->fi = fi;
-        (indata2 + i)->he = he + dhe;
-        (indata2 + i)->ve = ve;
+
+    memset(& head, 0, sizeof(nbghead));
+    head.hash = 2166136261u;
+
+    for (i = 0; i < n; i++) {
+        fscanf(i < n1 ? in1 : in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe);
+        (ps + i)->ni = i < n1 ? 1 : 2;
+        (ps + i)->la = la;
+        (ps + i)->fi = fi;
+        (ps + i)->he = he + dhe;
+        (ps + i)->ve = ve;
+        head.hash = hash_ps(head.hash, la, fi);
     }
+    fclose(in1);
     fclose(in2);
 
-    // ---------------------------------------------------------------
+    /* Pairs up to 1 m beyond the radius are stored so that rounding
+     * of coordinates in the text files does not drop pairs near the
+     * radius. Users of the graph recompute the distances anyway. */
+    dm = (dam + 1.0) / R * C * (dam + 1.0) / R * C;
+    grid_build(& grid, ps, n, (dam + 1.0) / R * C);
 
-    if ((buffer = (psxys * ) malloc(nb * sizeof(psxys))) == NULL) {
-        error("\nNot enough memory to allocate buffer\n");
-        exit(1);
+    printf("\n Search neighbours ...\n");
+
+    // number of neighbours of every PS
+    first[0] = 0;
+    #pragma omp parallel
+    {
+        int * tnbr = NULL, tnnbr = 0, ii;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (ii = 0; ii < n; ii++)
+            first[ii + 1] = grid_query(& grid, ps, (ps + ii)->la, (ps + ii)->fi,
+                                       dm, & tnbr, & tnnbr) - 1; // without itself
+        free(tnbr);
+    }
+
+    for (i = 0, nbr_max = 0; i < n; i++) {
+        if (first[i + 1] > nbr_max) nbr_max = first[i + 1];
+        first[i + 1] += first[i];
     }
+    nnz = first[n];
 
-    printf("\n selected clusters:\n");
+    if ((nbr = (int * ) malloc((nnz + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate neighbour graph\n");
+        exit(1);
+    }
 
-    nps = nc = nhc = nsc = 0;
+    // neighbours of every PS sorted by index
+    #pragma omp parallel
+    {
+        int * tnbr = NULL, tnnbr = 0, ii, jj, m;
+        long long k;
 
-    do {
-        nps = cluster(indata1, n1, indata2, n2, buffer, & nb, dam);
+        #pragma omp for schedule(dynamic, 256)
+        for (ii = 0; ii < n; ii++) {
+            m = grid_query(& grid, ps, (ps + ii)->la, (ps + ii)->fi, dm, & tnbr, & tnnbr);
+            qsort(tnbr, m, sizeof(int), cmp_int);
 
-        ps1 = ps2 = 0;
-        for (i = 0; i < nps; i++) {
-            if ((buffer + i)->ni == 1) ps1++;
-            else if ((buffer + i)->ni == 2) ps2++;
+            for (jj = 0, k = first[ii]; jj < m; jj++) {
+                if (tnbr[jj] == ii) continue;
+                nbr[k++] = tnbr[jj];
+            }
         }
+        free(tnbr);
+    }
+    grid_free(& grid);
 
-        if ((ps1 * ps2) > 0) {
-            estim_dominant(buffer, ps1, ps2, lo, ou); // ************ 
-            nsc++;
-        } else if ((ps1 + ps2) > 0) nhc++;
+    memcpy(head.magic, "DAISYNBG", 8);
+    head.version = 2;
+    head.n1 = n1;
+    head.n2 = n2;
+    head.radius = dam;
+    head.nnz = nnz;
 
-        nc++;
-        if ((nc % 2000) == 0) printf("\n %6d ...", nc);
+    if ((ou = fopen(out, "wb")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+    if (fwrite(& head, sizeof(nbghead), 1, ou) != 1 ||
+        fwrite(first, sizeof(long long), n + 1, ou) != (size_t) (n + 1) ||
+        fwrite(nbr, sizeof(int), nnz, ou) != (size_t) nnz) {
+        errorln("\n  Writing of %s failed !", out);
+        exit(1);
+    }
+    fclose(ou);
 
-    } while (nps > 0);
+    printf("\n\n PSs %d (asc %d dsc %d)\n neighbour pairs %lld\n max. neighbours %d\n",
+           n, n1, n2, nnz, nbr_max);
+    fprintf(lo, "\n PSs %d (asc %d dsc %d)\n neighbour pairs %lld\n max. neighbours %d\n",
+            n, n1, n2, nnz, nbr_max);
+    fclose(lo);
 
-    printf("\n %6d", nc - 1);
+    free(ps);
+    free(first);
+    free(nbr);
+    free(out);
 
-    printf("\n\n hermit   clusters: %6d\n accepted clusters: %6d\n", nhc, nsc);
-    printf("\n Records of %s file:\n", out);
-    printf("\n longitude latitude  height asc_v dsc_v");
-    printf("\n (     degree          m      mm/year )\n");
+    printf("\n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                  END NEIGHBOURS                    +\
+            \n ++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
 
-    fprintf(lo, "\n hermit   clusters: %6d\n accepted clusters: %6d\n", nhc, nsc);
-    fprintf(lo, "\n Records of %s file:\n", out);
-    fprintf(lo, "\n longitude latitude  height asc_v dsc_v");
-    fprintf(lo, "\n (     degree          m      mm/year )\n\n");
+    return (0);
+} // end neighbours
+
+int clip(int argc, char * argv[]) {
+    int i, k, start, end, nv, nring, nvmax, index, * ring;
+    long r, nline, nsel; // records of the data file
+    double * vla, * vfi;
+    char * buf, * inside, row[256];
+    size_t j, size, * line; // byte offsets
+
+    pgclip pg;
+    char *log = "clip.log";
+    FILE *in, *ou, *lo;
 
     printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
-            \n +                      END DOMINANT                     +\
-            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+            \n +                          CLIP                         +\
+            \n +        PSs inside of polygons are selected            +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
 
-    return (0);
-} // end dominant   
+    if (argc - Minarg < 3) {
+        printf("\n    usage:  daisy clip aoi.xy asc_data.xy asc_aoi.xy\n\
+                \n            aoi.xy         - (1st) polygon file, longitude\
+                \n                             latitude of vertices (degree),\
+                \n                             rings are separated by lines\
+                \n                             starting with > or empty lines\
+                \n            asc_data.xy    - (2nd) data file of any daisy\
+                \n                             format (longitude and latitude\
+                \n                             are the first two columns)\
+                \n            asc_aoi.xy     - (3rd) output, records of PSs\
+                \n                             inside of the polygons\n\
+                \n    options:\
+                \n            --index        - line numbers (starting with 1)\
+                \n                             of the selected records are\
+                \n                             written instead of records\n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
 
-int integrate(int argc, char * argv[]) {
-    int i, j, n = 0;
-    station ps, sat;
-    double azi1, inc1, azi2, inc2;
-    double ft1, lt1,     // first and llast time of orbit files
-           ft2, lt2,     // first and llast time of orbit files
-           *pol1, *pol2; // orbit polinomials
-    int dop1, dop2;      // degree of orbit polinomials
+    index = get_flag(argc, argv, "--index");
 
-    float la, fi, he, v1, v2, up, east;
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+    fprintf(lo, "\n %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3], argv[4]);
 
-    char *buf, *out = "integrate.xyi", // output files 
-               *log = "integrate.log"; // output files
+    printf("\n polygons: %s\n    input: %s\n   output: %s\n", argv[2], argv[3], argv[4]);
+    fprintf(lo, "\n polygons: %s\n    input: %s\n   output: %s\n", argv[2], argv[3], argv[4]);
 
-    FILE *ind, * ino1, *ino2, *ou, *lo;
+    // ---------------------------------------------------------------
+    // polygons
+    if ((in = fopen(argv[2], "rt")) == NULL) {
+        errorln("\n  %s polygon file not found !", argv[2]);
+        exit(1);
+    }
 
-    if ((buf = (char * ) malloc(80 * sizeof(char))) == NULL) {
-        error("\nNot enough memory to allocate BUF\n");
+    nvmax = 1024;
+    if ((vla = (double * ) malloc(nvmax * sizeof(double))) == NULL ||
+        (vfi = (double * ) malloc(nvmax * sizeof(double))) == NULL ||
+        (ring = (int * ) malloc((nvmax + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate polygons\n");
         exit(1);
     }
 
-    //  printf("argc: %d\n",argc);  
-    //  printf("%s\n",argv[0]);
-    //  printf("%s\n",argv[1]);  
-    //  printf("%s\n",argv[2]);    
-    //  printf("%s\n",argv[3]);   
+    nv = nring = 0;
+    ring[0] = 0;
+    while (fgets(row, sizeof(row), in) != NULL) {
+        if (nv == nvmax) {
+            nvmax *= 2;
+            if ((vla = (double * ) realloc(vla, nvmax * sizeof(double))) == NULL ||
+                (vfi = (double * ) realloc(vfi, nvmax * sizeof(double))) == NULL ||
+                (ring = (int * ) realloc(ring, (nvmax + 1) * sizeof(int))) == NULL) {
+                error("\nNot enough memory to allocate polygons\n");
+                exit(1);
+            }
+        }
+        if (sscanf(row, "%lf %lf", vla + nv, vfi + nv) == 2)
+            nv++;
+        else if (nv > ring[nring]) // end of ring
+            ring[++nring] = nv;
+    }
+    if (nv > ring[nring]) ring[++nring] = nv;
+    fclose(in);
+
+    // rings with less than 3 vertices are dropped
+    for (i = 0, k = 0, nv = 0, end = ring[0]; i < nring; i++) {
+        start = end;
+        end = ring[i + 1];
+        if (end - start < 3) continue;
+
+        memmove(vla + nv, vla + start, (end - start) * sizeof(double));
+        memmove(vfi + nv, vfi + start, (end - start) * sizeof(double));
+        nv += end - start;
+        ring[++k] = nv;
+    }
+    nring = k;
+
+    if (nv == 0) {
+        errorln("\n  No polygon in %s !", argv[2]);
+        exit(1);
+    }
+
+    clip_build(& pg, vla, vfi, ring, nring);
+
+    printf("\n Rings %d, vertices %d, grid %d x %d, edges in bands %d\n",
+           nring, nv, pg.nla, pg.nfi, pg.first[pg.nfi]);
+    fprintf(lo, "\n Rings %d, vertices %d, grid %d x %d, edges in bands %d\n",
+            nring, nv, pg.nla, pg.nfi, pg.first[pg.nfi]);
+
+    // ---------------------------------------------------------------
+    // records of the data file are kept in memory
+    if ((in = fopen(argv[3], "rb")) == NULL) {
+        errorln("\n  %s data file not found !", argv[3]);
+        exit(1);
+    }
+    fseek(in, 0, SEEK_END);
+    size = ftell(in);
+    rewind(in);
+
+    if ((buf = (char * ) malloc(size + 1)) == NULL) {
+        error("\nNot enough memory to allocate data\n");
+        exit(1);
+    }
+    if (fread(buf, 1, size, in) != size) {
+        errorln("\n  Reading of %s failed !", argv[3]);
+        exit(1);
+    }
+    buf[size] = '\0';
+    fclose(in);
+
+    for (j = 0, nline = 0; j < size; j++)
+        if (buf[j] == '\n') nline++;
+    if (size > 0 && buf[size - 1] != '\n') nline++;
+
+    if ((line = (size_t * ) malloc((nline + 1) * sizeof(size_t))) == NULL ||
+        (inside = (char * ) malloc(nline + 1)) == NULL) {
+        error("\nNot enough memory to allocate data\n");
+        exit(1);
+    }
+
+    // line[k] is the offset of the k-th record, new lines become '\0'
+    for (j = 0, nline = 0, line[0] = 0; j < size; j++)
+        if (buf[j] == '\n') {
+            buf[j] = '\0';
+            line[++nline] = j + 1;
+        }
+    if (line[nline] < size) line[++nline] = size + 1;
+
+    printf("\n Records %ld, clipping ...\n", nline);
+
+    #pragma omp parallel for schedule(dynamic, 4096)
+    for (r = 0; r < nline; r++) {
+        double la, fi;
+
+        inside[r] = sscanf(buf + line[r], "%lf %lf", & la, & fi) == 2
+                    && clip_inside(& pg, la, fi);
+    }
+
+    if ((ou = fopen(argv[4], "w+t")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+    for (r = 0, nsel = 0; r < nline; r++) {
+        if (!inside[r]) continue;
+
+        if (index) fprintf(ou, "%ld\n", r + 1);
+        else fprintf(ou, "%s\n", buf + line[r]);
+        nsel++;
+    }
+    fclose(ou);
+
+    printf("\n %s records %ld\n", argv[4], nsel);
+    fprintf(lo, "\n Records %ld\n %s records %ld\n\n", nline, argv[4], nsel);
+    fclose(lo);
+
+    clip_free(& pg);
+    free(vla);
+    free(vfi);
+    free(ring);
+    free(buf);
+    free(line);
+    free(inside);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                        END CLIP                       +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end clip
+
+int mosaic(int argc, char * argv[]) {
+    int i, j, f, n, nf, ndup, nout, * nps, * match, * root;
+    float tol, la, fi, ve, he, dhe, * dh;
+    double dm, cell, * off, * sum,
+           la0 = DBL_MAX, la1 = -DBL_MAX, fi0 = DBL_MAX, fi1 = -DBL_MAX;
+    pwsum so;
+
+    psxys * ps;
+    psgrid grid;
+
+    char *method = "mean", *log = "mosaic.log";
+    FILE *in, *ou, *lo;
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                         MOSAIC                        +\
+            \n +   PSs of adjacent frames of the same track are joined +\
+            \n +   and the PSs of the overlaps are merged              +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 4) {
+        printf("\n    usage:  daisy mosaic asc_data.xy 2.0 asc_frame1.xy asc_frame2.xy ...\n\
+                \n            asc_data.xy    - (1st) output data file\
+                \n            2.0            - (2nd) duplicate PS tolerance (m)\
+                \n            asc_frame1.xy  - (3rd, ...) data files of frames\n\
+                \n    options:\
+                \n            --merge=mean   - duplicates are averaged (mean)\
+                \n                             or the PS of the first frame\
+                \n                             is kept (first)\
+                \n            --harmonise    - velocity offsets of frames are\
+                \n                             estimated from duplicates and\
+                \n                             removed, first frame is the\
+                \n                             reference\n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    if (get_option(argc, argv, "--merge") != NULL)
+        method = get_option(argc, argv, "--merge");
+
+    if (!Str_IsEqual(method, "mean") && !Str_IsEqual(method, "first")) {
+        errorln("\n  Unknown merge method: %s (mean or first) !", method);
+        exit(1);
+    }
+
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+
+    sscanf(argv[3], "%f", & tol);
+    dm = tol / R * C * tol / R * C;
+
+    // frames are the positional arguments after the tolerance
+    for (i = Minarg + 2, nf = 0; i < argc && strncmp(argv[i], "--", 2) != 0; i++) nf++;
+
+    if ((nps = (int * ) calloc(nf + 1, sizeof(int))) == NULL ||
+        (off = (double * ) calloc(nf, sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate frames\n");
+        exit(1);
+    }
+
+    fprintf(lo, "\n");
+    for (i = 0; i < argc; i++) fprintf(lo, " %s", argv[i]);
+    fprintf(lo, "\n\n output: %s\n", argv[2]);
+    printf("\n output: %s\n", argv[2]);
+
+    // nps[f] is the index of the first PS of frame f
+    for (f = 0; f < nf; f++) {
+        if ((in = fopen(argv[Minarg + 2 + f], "rt")) == NULL) {
+            errorln("\n  %s data file not found !", argv[Minarg + 2 + f]);
+            exit(1);
+        }
+        n = 0;
+        while (fscanf(in, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n++;
+        fclose(in);
+        nps[f + 1] = nps[f] + n;
+
+        printf("  input: %s  PSs %d\n", argv[Minarg + 2 + f], n);
+        fprintf(lo, "  input: %s  PSs %d\n", argv[Minarg + 2 + f], n);
+    }
+    n = nps[nf];
+
+    if (n == 0) {
+        error("\n  No PSs in the frames !\n");
+        exit(1);
+    }
+
+    if ((ps = (psxys * ) malloc((n + 1) * sizeof(psxys))) == NULL ||
+        (dh = (float * ) malloc((n + 1) * sizeof(float))) == NULL ||
+        (match = (int * ) malloc((n + 1) * sizeof(int))) == NULL ||
+        (root = (int * ) malloc((n + 1) * sizeof(int))) == NULL ||
+        (sum = (double * ) calloc(6 * (size_t) (n + 1), sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate PSs\n");
+        exit(1);
+    }
+
+    for (f = 0; f < nf; f++) {
+        in = fopen(argv[Minarg + 2 + f], "rt");
+        for (i = nps[f]; i < nps[f + 1]; i++) {
+            fscanf(in, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe);
+            (ps + i)->ni = f;
+            (ps + i)->la = la;
+            (ps + i)->fi = fi;
+            (ps + i)->ve = ve;
+            (ps + i)->he = he;
+            dh[i] = dhe;
+        }
+        fclose(in);
+    }
+
+    printf("\n Duplicate PS tolerance %5.2f (m)\n", tol);
+    fprintf(lo, "\n Duplicate PS tolerance %5.2f (m)\n", tol);
+
+    // cells are not smaller than the mean distance of PSs
+    for (i = 0; i < n; i++) {
+        if ((ps + i)->la < la0) la0 = (ps + i)->la;
+        if ((ps + i)->la > la1) la1 = (ps + i)->la;
+        if ((ps + i)->fi < fi0) fi0 = (ps + i)->fi;
+        if ((ps + i)->fi > fi1) fi1 = (ps + i)->fi;
+    }
+    cell = sqrt((la1 - la0) * (fi1 - fi0) / n);
+    if (cell < tol / R * C) cell = tol / R * C;
+
+    grid_build(& grid, ps, n, cell);
+
+    // the closest PS of an earlier frame within the tolerance
+    #pragma omp parallel
+    {
+        int ii, kk, m, * nbr = NULL, nnbr = 0;
+        double dd, dmin, dla, dfi;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (ii = 0; ii < n; ii++) {
+            match[ii] = -1;
+            if ((ps + ii)->ni == 0) continue;
+
+            m = grid_query(& grid, ps, (ps + ii)->la, (ps + ii)->fi, dm, & nbr, & nnbr);
+            for (kk = 0, dmin = dm; kk < m; kk++) {
+                if ((ps + nbr[kk])->ni >= (ps + ii)->ni) continue;
+
+                dla = (ps + nbr[kk])->la - (ps + ii)->la;
+                dfi = (ps + nbr[kk])->fi - (ps + ii)->fi;
+                dd = dla * dla + dfi * dfi;
+
+                if (dd < dmin || (dd == dmin && nbr[kk] < match[ii])) {
+                    dmin = dd;
+                    match[ii] = nbr[kk];
+                }
+            }
+        }
+        free(nbr);
+    }
+    grid_free(& grid);
+
+    /* Velocity offset of a frame is the mean difference to the
+     * harmonised velocities of its duplicates in earlier frames. */
+    if (get_flag(argc, argv, "--harmonise")) {
+        printf("\n Velocity offsets of frames (mm/year):\n");
+        fprintf(lo, "\n Velocity offsets of frames (mm/year):\n");
+
+        printf("\n  %s %8.3f (reference)", argv[Minarg + 2], 0.0);
+        fprintf(lo, "\n  %s %8.3f (reference)", argv[Minarg + 2], 0.0);
+
+        for (f = 1; f < nf; f++) {
+            pw_init(& so);
+            for (i = nps[f]; i < nps[f + 1]; i++)
+                if (match[i] >= 0)
+                    pw_add(& so, (ps + i)->ve - ((ps + match[i])->ve - off[(ps + match[i])->ni]));
+
+            if (so.n > 0) off[f] = pw_total(& so) / so.n;
+
+            printf("\n  %s %8.3f (%lld duplicates)", argv[Minarg + 2 + f], off[f], so.n);
+            fprintf(lo, "\n  %s %8.3f (%lld duplicates)", argv[Minarg + 2 + f], off[f], so.n);
+        }
+        printf("\n");
+        fprintf(lo, "\n");
+
+        for (i = 0; i < n; i++) (ps + i)->ve -= off[(ps + i)->ni];
+    }
+
+    // duplicates are merged into the PS of the first frame
+    for (i = 0, ndup = 0; i < n; i++) {
+        root[i] = match[i] < 0 ? i : root[match[i]];
+        if (match[i] >= 0) ndup++;
+
+        if (Str_IsEqual(method, "first") && match[i] >= 0) continue;
+
+        sum[6 * root[i]]     += (ps + i)->la;
+        sum[6 * root[i] + 1] += (ps + i)->fi;
+        sum[6 * root[i] + 2] += (ps + i)->ve;
+        sum[6 * root[i] + 3] += (ps + i)->he;
+        sum[6 * root[i] + 4] += dh[i];
+        sum[6 * root[i] + 5] += 1.0;
+    }
+
+    if ((ou = fopen(argv[2], "w+t")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+    for (i = 0, nout = 0; i < n; i++) {
+        if (root[i] != i) continue;
+        for (j = 0; j < 5; j++) sum[6 * i + j] /= sum[6 * i + 5];
+
+        fprintf(ou, "%16.7e %16.7e %16.7e %16.7e %16.7e\n", sum[6 * i],
+                sum[6 * i + 1], sum[6 * i + 2], sum[6 * i + 3], sum[6 * i + 4]);
+        nout++;
+    }
+    fclose(ou);
+
+    printf("\n PSs of frames %d\n duplicate PSs %d (merge: %s)\n %s PSs %d\n",
+           n, ndup, method, argv[2], nout);
+    fprintf(lo, "\n PSs of frames %d\n duplicate PSs %d (merge: %s)\n %s PSs %d\n\n",
+            n, ndup, method, argv[2], nout);
+    fclose(lo);
+
+    free(ps);
+    free(dh);
+    free(match);
+    free(root);
+    free(sum);
+    free(nps);
+    free(off);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                       END MOSAIC                      +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end mosaic
+
+int dominant(int argc, char * argv[]) {
+    int i, j, n1, n2,  // number of data in input files
+        nc,         // number of preselected clusters 
+        nsc,        // number of selected clusters 
+        nhc,        // number of hermit clusters             
+        nnoise = 0, // number of dbscan noise PSs
+        ndam,       // number of cluster separations
+        min_pts = 4,// minimum number of neighbours of DBSCAN core points
+        ncl, * first, * idx, * acc; // members of clusters
+
+    psxys *indata, *indata1, *indata2; // names of allocated memories
+    psxyd *doms;
+    psgrid grid, cells;
+    nbgraph graph, * nb = NULL; // neighbour graph
+    unsigned int hash = 2166136261u;
+    char *out, *cls, // output files
+         *log = "dominant.log", // log output file
+         *method, *tok,         // clustering method
+         *nbg,                  // neighbour graph file
+         end;                   // trailing characters of a separation
+
+    FILE *in1, *in2, *ou, *lo;
+
+    float * dams, dam, la, fi, he, dhe, ve;
+    double dm;
+
+    //  printf("argc: %d\n",argc);  
+    //  printf("%s\n",argv[0]);
+    //  printf("%s\n",argv[1]);  
+    //  printf("%s\n",argv[2]);    
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                        DOMINANT                       +\
+            \n + clusters of ascending and descending PSs are selected +\
+            \n +     and the dominant points (DSs) are estimated       +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 3) {
+        printf("\n    usage:  daisy dominant asc_data.xys dsc_data.xys 100\n\
+                \n            asc_data.xys   - (1st) ascending  data file\
+                \n            dsc_data.xys   - (2nd) descending data file\
+                \n            100            - (3rd) cluster separation (m)\n\
+                \n            a comma separated list of separations\
+                \n            (e.g. 50,100,200,500) produces one\
+                \n            dominant_<separation>.xyd file for each\n\
+                \n    options:\
+                \n            --method=greedy - clustering method: greedy,\
+                \n                              grid or dbscan\
+                \n            --min_pts=4     - minimum number of neighbours\
+                \n                              of dbscan core points\
+                \n            --save_clusters - save the clusters of PSs into\
+                \n                              dominant.cls (input of\
+                \n                              dominant_update)\
+                \n            --graph=asc_data.xys.nbg - neighbour graph\
+                \n                              written by the neighbours\
+                \n                              module for the same input\
+                \n                              files, it is not used after\
+                \n                              any change of the PSs\n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    if ((method = get_option(argc, argv, "--method")) == NULL)
+        method = "greedy";
+
+    if (!Str_IsEqual(method, "greedy") && !Str_IsEqual(method, "grid")
+        && !Str_IsEqual(method, "dbscan")) {
+        errorln("\n  Unknown clustering method: %s !\n", method);
+        exit(1);
+    }
+
+    if (get_option(argc, argv, "--min_pts") != NULL
+        && (sscanf(get_option(argc, argv, "--min_pts"), "%d", & min_pts) != 1
+            || min_pts < 1)) {
+        errorln("\n  Wrong --min_pts: %s, it should be at least 1 !\n",
+                get_option(argc, argv, "--min_pts"));
+        exit(1);
+    }
+
+    if ((in1 = fopen(argv[2], "rt")) == NULL) {
+        error("\n  ASC data file not found !\n");
+        exit(1);
+    }
+    if ((in2 = fopen(argv[3], "rt")) == NULL) {
+        error("\n  DSC data file not found !\n");
+        exit(1);
+    }
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+
+    fprintf(lo, "\n %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3], argv[4]);
+
+    printf("\n  input: %s\n         %s\n", argv[2], argv[3]);
+    fprintf(lo, "\n  input: %s\n         %s\n", argv[2], argv[3]);
+
+    //------------------------------------------------------
+    ndam = 1;
+    for (i = 0; argv[4][i] != '\0'; i++)
+        if (argv[4][i] == ',') ndam++;
+
+    if ((dams = (float * ) malloc(ndam * sizeof(float))) == NULL ||
+        (out = (char * ) malloc(80 * sizeof(char))) == NULL ||
+        (cls = (char * ) malloc(80 * sizeof(char))) == NULL) {
+        error("\nNot enough memory to allocate separations\n");
+        exit(1);
+    }
+
+    // every separation is a positive number, strtok skips empty ones
+    // and they are caught by the number of commas
+    for (i = 0, tok = strtok(argv[4], ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (sscanf(tok, "%f%c", dams + i, & end) != 1 || !(dams[i] > 0.0)) {
+            errorln("\n  Wrong cluster separation: %s !\n", tok);
+            exit(1);
+        }
+        i++;
+    }
+    if (i != ndam) {
+        error("\n  Empty cluster separation in the list !\n");
+        exit(1);
+    }
+
+    printf("\n Clustering method: %s\n", method);
+    fprintf(lo, "\n Clustering method: %s\n\n", method);
+    // -----------------------------------------------------
+
+    printf("\n Copy data to memory ...\n");
+    
+    n1 = 0;
+    while (fscanf(in1, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n1++;
+    rewind(in1);
+
+    n2 = 0;
+    while (fscanf(in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n2++;
+    rewind(in2);
+
+    // ascending and descending PSs are stored next to each other
+    if ((indata = (psxys * ) malloc((n1 + n2 + 1) * sizeof(psxys))) == NULL) {
+        error("\nNot enough memory to allocate indata\n");
+        exit(1);
+    }
+    indata1 = indata;
+    indata2 = indata + n1;
+
+    for (i = 0; i < n1; i++) {
+        fscanf(in1, "%e %e %e %e %e", &la, &fi, &ve, &he, &dhe);
+        (indata1 + i)->ni = 1;
+        (indata1 + i)->la = la;
+        (indata1 + i)->fi = fi;
+        (indata1 + i)->he = he + dhe;
+        (indata1 + i)->ve = ve;
+    }
+    fclose(in1);
+
+    for (i = 0; i < n2; i++) {
+        fscanf(in2, "%e %e %e %e %e", &la, &fi, &ve, &he, &dhe);
+        (indata2 + i)->ni = 2;
+        (indata2 + i)->la = la;
+        (indata2 + i)->fi = fi;
+        (indata2 + i)->he = he + dhe;
+        (indata2 + i)->ve = ve;
+    }
+    fclose(in2);
+
+    // ---------------------------------------------------------------
+    // neighbour search structure for the largest separation,
+    // it is reused for every separation
+
+    dam = dams[0];
+    for (i = 1; i < ndam; i++) if (dams[i] > dam) dam = dams[i];
+
+    // a neighbour graph written by the neighbours module replaces the grid
+    if ((nbg = get_option(argc, argv, "--graph")) != NULL &&
+        !Str_IsEqual(method, "grid")) {
+        for (i = 0; i < n1 + n2; i++)
+            hash = hash_ps(hash, (indata + i)->la, (indata + i)->fi);
+
+        nbg_open(nbg, & graph);
+        if (nbg_usable(& graph, n1, n2, hash, dam, lo)) nb = & graph;
+        else nbg_close(& graph);
+    }
+
+    if (!Str_IsEqual(method, "grid") && nb == NULL)
+        grid_build(& grid, indata, n1 + n2, dam / R * C);
+    else {
+        // no grid, its origin is still written to the cluster file
+        grid.la0 = indata->la;
+        grid.fi0 = indata->fi;
+        for (i = 1; i < n1 + n2; i++) {
+            if ((indata + i)->la < grid.la0) grid.la0 = (indata + i)->la;
+            if ((indata + i)->fi < grid.fi0) grid.fi0 = (indata + i)->fi;
+        }
+    }
+
+    for (j = 0; j < ndam; j++) {
+        dam = dams[j];
+        dm = dam / R * C * dam / R * C;
+
+        if (ndam == 1) {
+            sprintf(out, "dominant.xyd");
+            sprintf(cls, "dominant.cls");
+        } else {
+            sprintf(out, "dominant_%g.xyd", dam);
+            sprintf(cls, "dominant_%g.cls", dam);
+        }
+
+        if ((ou = fopen(out, "w+t")) == NULL) {
+            error("\n  OUT data file not found !\n");
+            exit(1);
+        }
+
+        printf("\n output: %s\n\n", out);
+        fprintf(lo, "\n output: %s\n\n", out);
+        printf("\n Appr. cluster size %5.1f (m)\n", dam);
+        fprintf(lo, "\n Appr. cluster size %5.1f (m)\n\n", dam);
+
+        printf("\n selected clusters:\n");
+
+        nc = nhc = nsc = 0;
+
+        if (Str_IsEqual(method, "greedy"))
+            ncl = greedy_clusters(indata, n1, n2, & grid, nb, dm, & first, & idx);
+        else if (Str_IsEqual(method, "dbscan"))
+            ncl = dbscan_clusters(indata, n1 + n2, & grid, nb, dm, min_pts,
+                                  & first, & idx, & nnoise);
+        else {
+            // every cell of the grid is a cluster
+            grid_build(& cells, indata, n1 + n2, dam / R * C);
+            ncl = cells.nla * cells.nfi;
+            first = cells.first;
+            idx = cells.idx;
+        }
+
+        if ((doms = (psxyd * ) malloc((ncl + 1) * sizeof(psxyd))) == NULL ||
+            (acc = (int * ) malloc((ncl + 1) * sizeof(int))) == NULL) {
+            error("\nNot enough memory to allocate dominant points\n");
+            exit(1);
+        }
+
+        estim_clusters(indata, first, idx, ncl, doms, acc); // ************ 
+
+        if (get_flag(argc, argv, "--save_clusters")) {
+            if (Str_IsEqual(method, "grid"))
+                write_clusters(cls, method, dam, min_pts, cells.la0, cells.fi0,
+                               indata, n1 + n2, first, idx, ncl, acc);
+            else
+                write_clusters(cls, method, dam, min_pts, grid.la0, grid.fi0,
+                               indata, n1 + n2, first, idx, ncl, acc);
+
+            printf("\n clusters: %s\n", cls);
+            fprintf(lo, "\n clusters: %s\n", cls);
+        }
+
+        for (i = 0; i < ncl; i++) {
+            if (acc[i] < 0) continue;
+            
+            if (acc[i] > 0) {
+                write_dominant(ou, doms + i);
+                nsc++;
+            } else nhc++;
+            
+            nc++;
+            if ((nc % 2000) == 0) printf("\n %6d ...", nc);
+        }
+        
+        free(first);
+        free(idx);
+        free(doms);
+        free(acc);
+        fclose(ou);
+
+        printf("\n %6d", nc);
+
+        printf("\n\n hermit   clusters: %6d\n accepted clusters: %6d\n", nhc, nsc);
+        if (Str_IsEqual(method, "dbscan"))
+            printf(" noise PSs:         %6d\n", nnoise);
+        printf("\n Records of %s file:\n", out);
+        printf("\n longitude latitude  height asc_v dsc_v");
+        printf("\n (     degree          m      mm/year )\n");
+
+        fprintf(lo, "\n hermit   clusters: %6d\n accepted clusters: %6d\n", nhc, nsc);
+        if (Str_IsEqual(method, "dbscan"))
+            fprintf(lo, " noise PSs:         %6d\n", nnoise);
+        fprintf(lo, "\n Records of %s file:\n", out);
+        fprintf(lo, "\n longitude latitude  height asc_v dsc_v");
+        fprintf(lo, "\n (     degree          m      mm/year )\n\n");
+    }
+
+    if (nb != NULL)
+        nbg_close(nb);
+    else if (!Str_IsEqual(method, "grid"))
+        grid_free(& grid);
+
+    fclose(lo);
+    free(indata);
+    free(dams);
+    free(out);
+    free(cls);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                      END DOMINANT                     +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end dominant   
+
+int dominant_update(int argc, char * argv[]) {
+    int i, j, k, m, n,  // number of PSs in cluster file
+        ncl,            // number of clusters in cluster file
+        na, nr, nmiss,  // number of added, removed and not found PSs
+        nl, nl1,        // number of PSs and ascending PSs to recluster
+        nlcl,           // number of clusters of reclustered PSs
+        ntc,            // number of touched clusters
+        nnc,            // number of new clusters
+        nsc, nhc, min_pts, ni, nline, * label, * nps1, * nps2,
+        * line, * touched, * src, * newlab, * loclab, * first, * idx, * acc,
+        * nbr = NULL, nnbr = 0, ila, ifi;
+
+    psxys *ps, *add, *local;
+    psxyd *doms;
+    psgrid grid;
+    char method[16], sign[4], buf[256], **lines, *out, *cls = argv[2],
+         *log = "dominant_update.log";
+
+    FILE *cl, *de, *ou, *lo;
+
+    float dam, la, fi, he, dhe, ve;
+    double dm, dd, dmin, la0, fi0, cell;
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                    DOMINANT_UPDATE                    +\
+            \n +   clusters touched by added or removed PSs are        +\
+            \n +   recomputed and the dominant file is patched         +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 2) {
+        printf("\n    usage:  daisy dominant_update dominant.cls delta.xys\n\
+                \n            dominant.cls - (1st) clusters saved by\
+                \n                           dominant --save_clusters\
+                \n            delta.xys    - (2nd) added and removed PSs\n\
+                \n    grid clusters are the same as after a full rerun,\
+                \n    greedy clusters next to the changes can differ,\
+                \n    dbscan clusters are not supported.\n\
+                \n    records of delta.xys:\
+                \n            +/- track longitude latitude velocity height dheight\
+                \n            where track is 1 (ascending) or 2 (descending)\n\
+                \n    dominant.xyd and dominant.cls are updated in place.\n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    if ((out = (char * ) malloc((strlen(cls) + 8) * sizeof(char))) == NULL) {
+        error("\nNot enough memory to allocate OUT\n");
+        exit(1);
+    }
+    sprintf(out, "%s", cls);
+    change_ext(out, "xyd");
+
+    if ((cl = fopen(cls, "rt")) == NULL) {
+        error("\n  Cluster file not found !\n");
+        exit(1);
+    }
+    if ((de = fopen(argv[3], "rt")) == NULL) {
+        error("\n  Delta file not found !\n");
+        exit(1);
+    }
+    if ((ou = fopen(out, "rt")) == NULL) {
+        error("\n  Dominant file not found !\n");
+        exit(1);
+    }
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+
+    fprintf(lo, "\n %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3]);
+
+    printf("\n  input: %s\n         %s\n         %s\n", cls, out, argv[3]);
+    fprintf(lo, "\n  input: %s\n         %s\n         %s\n", cls, out, argv[3]);
+
+    // -----------------------------------------------------------------
+    // previous clusters
+
+    if (fscanf(cl, "%15s %f %d %lf %lf %d %d", method, & dam, & min_pts,
+               & la0, & fi0, & ncl, & n) != 7) {
+        error("\n  Wrong cluster file header !\n");
+        exit(1);
+    }
+
+    // new core points of DBSCAN can merge clusters far from the added
+    // PSs, a local update cannot reproduce the clusters of a full rerun
+    if (Str_IsEqual(method, "dbscan")) {
+        error("\n  dbscan clusters cannot be updated, rerun dominant !\n");
+        exit(1);
+    }
+
+    printf("\n Clustering method: %s\n Appr. cluster size %5.1f (m)\n",
+           method, dam);
+    fprintf(lo, "\n Clustering method: %s\n Appr. cluster size %5.1f (m)\n",
+            method, dam);
+
+    if ((ps = (psxys * ) malloc((n + 1) * sizeof(psxys))) == NULL ||
+        (label = (int * ) malloc((n + 1) * sizeof(int))) == NULL ||
+        (touched = (int * ) calloc(ncl + 1, sizeof(int))) == NULL ||
+        (nps1 = (int * ) calloc(ncl + 1, sizeof(int))) == NULL ||
+        (nps2 = (int * ) calloc(ncl + 1, sizeof(int))) == NULL ||
+        (line = (int * ) malloc((ncl + 1) * sizeof(int))) == NULL ||
+        (newlab = (int * ) malloc((ncl + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate clusters\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++) {
+        fscanf(cl, "%d %d %e %e %e %e", & (ps + i)->ni, label + i,
+               & (ps + i)->la, & (ps + i)->fi, & (ps + i)->he, & (ps + i)->ve);
+
+        if (label[i] < 0) continue;
+        if ((ps + i)->ni == 1) nps1[label[i]]++;
+        else nps2[label[i]]++;
+    }
+    fclose(cl);
+
+    // line of the dominant point of accepted clusters in the dominant file
+    for (k = j = 0; k < ncl; k++)
+        line[k] = nps1[k] * nps2[k] > 0 ? j++ : -1;
+
+    nline = j;
+    if ((lines = (char ** ) malloc((nline + 1) * sizeof(char * ))) == NULL) {
+        error("\nNot enough memory to allocate lines\n");
+        exit(1);
+    }
+    for (j = 0; j < nline; j++) {
+        if (fgets(buf, 256, ou) == NULL) {
+            error("\n  Dominant file does not match the cluster file !\n");
+            exit(1);
+        }
+        if ((lines[j] = (char * ) malloc((strlen(buf) + 1) * sizeof(char))) == NULL) {
+            error("\nNot enough memory to allocate lines\n");
+            exit(1);
+        }
+        strcpy(lines[j], buf);
+    }
+    fclose(ou);
+
+    // -----------------------------------------------------------------
+    // added and removed PSs
+
+    cell = dam / R * C;
+    dm = dam / R * C * dam / R * C;
+    grid_build(& grid, ps, n, cell);
+
+    na = nr = nmiss = 0;
+    while (fscanf(de, "%3s %d %e %e %e %e %e", sign, & ni, & la, & fi, & ve,
+                  & he, & dhe) == 7) na += (sign[0] == '+');
+    rewind(de);
+
+    if ((add = (psxys * ) malloc((na + 1) * sizeof(psxys))) == NULL ||
+        (src = (int * ) malloc((n + na + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate added PSs\n");
+        exit(1);
+    }
+
+    // src[i] marks the PSs that are reclustered: 1 - yes, 0 - no, -1 - removed
+    for (i = 0; i < n; i++)
+        src[i] = label[i] < 0 ? 0 : -2; // -2: decided by its cluster
+    for (i = n; i < n + na; i++) src[i] = 1;
+
+    na = 0;
+    while (fscanf(de, "%3s %d %e %e %e %e %e", sign, & ni, & la, & fi, & ve,
+                  & he, & dhe) == 7) {
+        if (sign[0] == '+') {
+            (add + na)->ni = ni;
+            (add + na)->la = la;
+            (add + na)->fi = fi;
+            (add + na)->he = he + dhe;
+            (add + na)->ve = ve;
+            na++;
+
+            // clusters and free PSs in the neighbourhood are reclustered
+            m = grid_query(& grid, ps, la, fi, dm, & nbr, & nnbr);
+            for (k = 0; k < m; k++) {
+                if (label[nbr[k]] >= 0) touched[label[nbr[k]]] = 1;
+                else if (src[nbr[k]] == 0) src[nbr[k]] = 1;
+            }
+
+            // grid: the cluster of the cell of the PS, its members can be
+            // farther than dam (up to the diagonal of the cell)
+            if (Str_IsEqual(method, "grid")) {
+                ila = (int) floor((la - la0) / cell);
+                ifi = (int) floor((fi - fi0) / cell);
+
+                m = grid_query(& grid, ps, la, fi, 2.0 * cell * cell, & nbr,
+                               & nnbr);
+                for (k = 0; k < m; k++) {
+                    j = nbr[k];
+                    if (label[j] >= 0
+                        && (int) floor(((ps + j)->la - la0) / cell) == ila
+                        && (int) floor(((ps + j)->fi - fi0) / cell) == ifi)
+                        touched[label[j]] = 1;
+                }
+            }
+        }
+        else if (sign[0] == '-') {
+            // the nearest not yet removed PS of the same track
+            m = grid_query(& grid, ps, la, fi, 1.0e-12, & nbr, & nnbr);
+            
+            for (k = 0, j = -1, dmin = 1.0; k < m; k++) {
+                dd = ((ps + nbr[k])->la - la) * ((ps + nbr[k])->la - la)
+                   + ((ps + nbr[k])->fi - fi) * ((ps + nbr[k])->fi - fi);
+
+                if ((ps + nbr[k])->ni == ni && src[nbr[k]] != -1 && dd < dmin) {
+                    j = nbr[k];
+                    dmin = dd;
+                }
+            }
+
+            if (j < 0) {
+                nmiss++;
+                continue;
+            }
+            if (label[j] >= 0) touched[label[j]] = 1;
+            src[j] = -1;
+            nr++;
+        }
+    }
+    fclose(de);
+    free(nbr);
+    grid_free(& grid);
+
+    for (i = 0; i < n; i++)
+        if (src[i] == -2) src[i] = touched[label[i]];
+
+    for (k = ntc = 0; k < ncl; k++) ntc += touched[k];
+
+    printf("\n added PSs: %d\n removed PSs: %d\n not found PSs: %d\n touched clusters: %d\n",
+           na, nr, nmiss, ntc);
+    fprintf(lo, "\n added PSs: %d\n removed PSs: %d\n not found PSs: %d\n touched clusters: %d\n",
+            na, nr, nmiss, ntc);
+
+    // -----------------------------------------------------------------
+    // reclustering, ascending PSs precede descending ones
+
+    for (i = 0, nl = na; i < n; i++) nl += (src[i] == 1);
+
+    if ((local = (psxys * ) malloc((nl + 1) * sizeof(psxys))) == NULL ||
+        (idx = (int * ) malloc((nl + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate local PSs\n");
+        exit(1);
+    }
+
+    // idx[l] is the index of the l-th local PS, n + i for added ones
+    for (ni = 1, nl = 0; ni <= 2; ni++) {
+        for (i = 0; i < n; i++)
+            if (src[i] == 1 && (ps + i)->ni == ni) idx[nl++] = i;
+        for (i = 0; i < na; i++)
+            if ((add + i)->ni == ni) idx[nl++] = n + i;
+        if (ni == 1) nl1 = nl;
+    }
+    for (i = 0; i < nl; i++)
+        *(local + i) = idx[i] < n ? *(ps + idx[i]) : *(add + idx[i] - n);
+
+    // newlab[k]: new number of the k-th untouched cluster
+    for (k = j = 0; k < ncl; k++)
+        newlab[k] = touched[k] ? -1 : j++;
+
+    // src is reused as the index of PSs in local, -2 if not reclustered
+    for (i = 0; i < n + na; i++) src[i] = src[i] == -1 ? -1 : -2;
+    for (i = 0; i < nl; i++) src[idx[i]] = i;
+    free(idx);
+
+    nlcl = 0;
+    first = idx = NULL;
+
+    if (nl > 0 && Str_IsEqual(method, "grid")) {
+        grid_build_aligned(& grid, local, nl, dam / R * C, la0, fi0);
+        nlcl = grid.nla * grid.nfi;
+        first = grid.first;
+        idx = grid.idx;
+    }
+    else if (nl > 0) {
+        grid_build(& grid, local, nl, dam / R * C);
+        nlcl = greedy_clusters(local, nl1, nl - nl1, & grid, NULL, dm,
+                               & first, & idx);
+        grid_free(& grid);
+    }
+
+    if ((doms = (psxyd * ) malloc((nlcl + 1) * sizeof(psxyd))) == NULL ||
+        (acc = (int * ) malloc((nlcl + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate dominant points\n");
+        exit(1);
+    }
+
+    estim_clusters(local, first, idx, nlcl, doms, acc); // ************ 
+
+    // -----------------------------------------------------------------
+    // patched dominant file: untouched clusters keep their lines,
+    // new clusters are appended
+
+    if ((ou = fopen(out, "w+t")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+
+    for (k = nsc = 0; k < ncl; k++) {
+        if (!touched[k] && line[k] >= 0) {
+            fputs(lines[line[k]], ou);
+            nsc++;
+        }
+    }
+    for (k = nnc = nhc = 0; k < nlcl; k++) {
+        if (acc[k] > 0) {
+            write_dominant(ou, doms + k);
+            nsc++;
+        }
+        else if (acc[k] == 0) nhc++;
+        if (acc[k] >= 0) nnc++;
+    }
+    fclose(ou);
+
+    // new cluster file, clusters are numbered in the same order
+    if ((ps = (psxys * ) realloc(ps, (n + na + 1) * sizeof(psxys))) == NULL ||
+        (loclab = (int * ) malloc((nl + 1) * sizeof(int))) == NULL) {
+        error("\nNot enough memory to allocate clusters\n");
+        exit(1);
+    }
+    for (i = 0; i < na; i++) *(ps + n + i) = *(add + i);
+
+    for (k = j = 0; k < ncl; k++) j += !touched[k];
+    
+    for (i = 0; i < nl; i++) loclab[i] = -1;
+    for (k = 0; k < nlcl; k++) {
+        if (acc[k] < 0) continue;
+        for (i = first[k]; i < first[k + 1]; i++) loclab[idx[i]] = j;
+        j++;
+    }
+
+    if ((cl = fopen(cls, "w+t")) == NULL) {
+        error("\n  Cluster file could not be opened !\n");
+        exit(1);
+    }
+
+    fprintf(cl, "%s %g %d %.15e %.15e %d %d\n", method, dam, min_pts, la0, fi0,
+            j, n + na - nr);
+
+    for (i = 0; i < n + na; i++) {
+        if (src[i] == -1) continue;
+
+        if (src[i] >= 0) k = loclab[src[i]];
+        else k = label[i] >= 0 ? newlab[label[i]] : -1;
+
+        fprintf(cl, "%d %6d %16.8e %16.8e %16.8e %16.8e\n", (ps + i)->ni, k,
+                (ps + i)->la, (ps + i)->fi, (ps + i)->he, (ps + i)->ve);
+    }
+    fclose(cl);
+
+    printf("\n reclustered PSs: %d\n new clusters: %d\n hermit clusters: %d\n accepted clusters: %d\n",
+           nl, nnc, nhc, nsc);
+    fprintf(lo, "\n reclustered PSs: %d\n new clusters: %d\n hermit clusters: %d\n accepted clusters: %d\n",
+            nl, nnc, nhc, nsc);
+
+    printf("\n outputs: %s\n          %s\n", out, cls);
+    fprintf(lo, "\n outputs: %s\n          %s\n\n", out, cls);
+    fclose(lo);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                  END DOMINANT_UPDATE                  +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end dominant_update
+
+static int cmp_area(void const * a, void const * b)
+{
+    // decreasing density, increasing index for equal densities
+    psarea const * aa = (psarea const * ) a, * bb = (psarea const * ) b;
+
+    if (aa->density > bb->density) return (-1);
+    if (aa->density < bb->density) return (1);
+    return ((aa->ic > bb->ic) - (aa->ic < bb->ic));
+} // end cmp_area
+
+int zero_select(int argc, char * argv[]) {
+    int i, j, k, n1, n2, na, nsel,
+        min_ps = 10, // minimum number of PSs per track
+        top = 10;    // number of selected areas
+    float dam, tol, frac = 0.9, la, fi, he, dhe, ve;
+    double dm, dla, dfi; // squared radius, differences of the centres
+
+    psxys * indata;
+    psarea * areas;
+    psgrid grid;
+
+    char *out = "zero_select.xyz", *log = "zero_select.log";
+    FILE *in1, *in2, *ou, *lo;
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                      ZERO_SELECT                      +\
+            \n +   stable reference areas with near zero ascending     +\
+            \n +   and descending velocities are selected              +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 4) {
+        printf("\n    usage:  daisy zero_select asc_data.xys dsc_data.xys 200 1.0\n\
+                \n            asc_data.xys   - (1st) ascending  data file\
+                \n            dsc_data.xys   - (2nd) descending data file\
+                \n            200            - (3rd) radius of areas (m)\
+                \n            1.0            - (4th) velocity tolerance (mm/year)\n\
+                \n    options:\
+                \n            --min_ps=10    - minimum number of PSs of\
+                \n                             both tracks in an area\
+                \n            --fraction=0.9 - minimum fraction of PSs with\
+                \n                             velocity within tolerance\
+                \n            --top=10       - number of selected areas\n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    if (get_option(argc, argv, "--min_ps") != NULL)
+        sscanf(get_option(argc, argv, "--min_ps"), "%d", & min_ps);
+    if (get_option(argc, argv, "--fraction") != NULL)
+        sscanf(get_option(argc, argv, "--fraction"), "%f", & frac);
+    if (get_option(argc, argv, "--top") != NULL)
+        sscanf(get_option(argc, argv, "--top"), "%d", & top);
+
+    if ((in1 = fopen(argv[2], "rt")) == NULL) {
+        error("\n  ASC data file not found !\n");
+        exit(1);
+    }
+    if ((in2 = fopen(argv[3], "rt")) == NULL) {
+        error("\n  DSC data file not found !\n");
+        exit(1);
+    }
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+
+    sscanf(argv[4], "%f", & dam);
+    sscanf(argv[5], "%f", & tol);
+    dm = dam / R * C * dam / R * C;
+
+    fprintf(lo, "\n %s %s %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3],
+            argv[4], argv[5]);
+
+    printf("\n  input: %s\n         %s\n output: %s\n", argv[2], argv[3], out);
+    fprintf(lo, "\n  input: %s\n         %s\n output: %s\n", argv[2], argv[3], out);
+    printf("\n Radius of areas %5.1f (m), velocity tolerance %5.2f (mm/year)\n", dam, tol);
+    fprintf(lo, "\n Radius of areas %5.1f (m), velocity tolerance %5.2f (mm/year)\n", dam, tol);
+    printf(" Minimum PSs per track %d, minimum stable fraction %4.2f\n", min_ps, frac);
+    fprintf(lo, " Minimum PSs per track %d, minimum stable fraction %4.2f\n", min_ps, frac);
+
+    // -----------------------------------------------------------
+    n1 = 0;
+    while (fscanf(in1, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n1++;
+    rewind(in1);
+
+    n2 = 0;
+    while (fscanf(in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n2++;
+    rewind(in2);
+
+    if ((indata = (psxys * ) malloc((n1 + n2 + 1) * sizeof(psxys))) == NULL ||
+        (areas = (psarea * ) malloc((n1 + n2 + 1) * sizeof(psarea))) == NULL) {
+        error("\nNot enough memory to allocate indata\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n1 + n2; i++) {
+        fscanf(i < n1 ? in1 : in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe);
+        (indata + i)->ni = i < n1 ? 1 : 2;
+        (indata + i)->la = la;
+        (indata + i)->fi = fi;
+        (indata + i)->he = he + dhe;
+        (indata + i)->ve = ve;
+    }
+    fclose(in1);
+    fclose(in2);
+
+    grid_build(& grid, indata, n1 + n2, dam / R * C);
+
+    printf("\n Scoring %d candidate areas ...\n", n1 + n2);
+
+    /* Every PS within the tolerance is the centre of a candidate area
+     * containing the PSs closer than the radius. */
+    na = 0;
+    #pragma omp parallel
+    {
+        int ii, kk, m, * nbr = NULL, nnbr = 0, ns[2], nok[2], t;
+        pwsum sv[2], svv[2];
+        psarea a;
+
+        #pragma omp for schedule(dynamic, 256)
+        for (ii = 0; ii < n1 + n2; ii++) {
+            if (fabs((indata + ii)->ve) > tol) continue;
+
+            m = grid_query(& grid, indata, (indata + ii)->la, (indata + ii)->fi,
+                           dm, & nbr, & nnbr);
+
+            ns[0] = ns[1] = nok[0] = nok[1] = 0;
+            for (t = 0; t < 2; t++) {
+                pw_init(sv + t);
+                pw_init(svv + t);
+            }
+            // PSs in increasing index order so the sums do not depend on the index
+            qsort(nbr, m, sizeof(int), cmp_int);
+
+            for (kk = 0; kk < m; kk++) {
+                t = nbr[kk] < n1 ? 0 : 1;
+                ns[t]++;
+                if (fabs((indata + nbr[kk])->ve) <= tol) nok[t]++;
+                pw_add(sv + t, (indata + nbr[kk])->ve);
+                pw_add(svv + t, (indata + nbr[kk])->ve * (indata + nbr[kk])->ve);
+            }
+            if (ns[0] < min_ps || ns[1] < min_ps ||
+                nok[0] < frac * ns[0] || nok[1] < frac * ns[1]) continue;
+
+            a.ic = ii;
+            a.n1 = ns[0];
+            a.n2 = ns[1];
+            for (t = 0; t < 2; t++) {
+                a.mean[t] = pw_total(sv + t) / ns[t];
+                a.std[t] = sqrt(fabs(pw_total(svv + t) / ns[t] - a.mean[t] * a.mean[t]));
+            }
+            if (fabs(a.mean[0]) > tol || fabs(a.mean[1]) > tol) continue;
+
+            a.density = m / (M_PI * dam * dam * 1.0e-6); // [PS/km^2]
+
+            #pragma omp critical
+            areas[na++] = a;
+        }
+        free(nbr);
+    }
+
+    // order of the candidates does not depend on the threads
+    qsort(areas, na, sizeof(psarea), cmp_area);
+
+    // the densest areas that do not overlap the already selected ones
+    for (i = 0, nsel = 0; i < na && nsel < top; i++) {
+        for (j = 0; j < nsel; j++) {
+            dla = (double) (indata + areas[j].ic)->la - (indata + areas[i].ic)->la;
+            dfi = (double) (indata + areas[j].ic)->fi - (indata + areas[i].ic)->fi;
+            if (dla * dla + dfi * dfi < 4.0 * dm) break;
+        }
+        if (j == nsel) areas[nsel++] = areas[i];
+    }
+
+    if ((ou = fopen(out, "w+t")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+    for (k = 0; k < nsel; k++)
+        fprintf(ou, "%16.7e %15.7e %9.3f %5d %5d %8.3f %8.3f %8.3f %8.3f %10.1f\n",
+                (indata + areas[k].ic)->la, (indata + areas[k].ic)->fi,
+                (indata + areas[k].ic)->he, areas[k].n1, areas[k].n2,
+                areas[k].mean[0], areas[k].mean[1], areas[k].std[0],
+                areas[k].std[1], areas[k].density);
+    fclose(ou);
+
+    printf("\n candidate areas: %6d\n selected  areas: %6d\n", na, nsel);
+    printf("\n Records of %s file:\n", out);
+    printf("\n longitude latitude height asc_n dsc_n asc_v dsc_v asc_std dsc_std density");
+    printf("\n (     degree          m                 mm/year                PS/km^2 )\n");
+
+    fprintf(lo, "\n candidate areas: %6d\n selected  areas: %6d\n", na, nsel);
+    fprintf(lo, "\n Records of %s file:\n", out);
+    fprintf(lo, "\n longitude latitude height asc_n dsc_n asc_v dsc_v asc_std dsc_std density");
+    fprintf(lo, "\n (     degree          m                 mm/year                PS/km^2 )\n\n");
+    fclose(lo);
+
+    grid_free(& grid);
+    free(indata);
+    free(areas);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                    END ZERO_SELECT                    +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end zero_select
+
+int integrate(int argc, char * argv[]) {
+    int i, j, k, m, n = 0, max_iter = Doppler_maxiter, warm, ncold = 0;
+    long iter = 0, cold = 0;
+    station ps[orbit_lanes], sat;
+    double azi1, inc1, azi2, inc2, tol = Doppler_tol;
+    double xyz[3 * orbit_lanes], sat1[3 * orbit_lanes], sat2[3 * orbit_lanes];
+    double t1[orbit_lanes], t2[orbit_lanes], tc[orbit_lanes],
+           c1[orbit_lanes], c2[orbit_lanes], r1 = 0.0, r2 = 0.0, p1 = 0.0,
+           p2 = 0.0;
+    orbit_poly orb1, orb2; // orbit polinomials
+    azmodel am1, am2;
+
+    float la, fi, he, v1, v2, up, east, * vel;
+    psxyd * pts;
+    pstime * ord;
+
+    char *buf, *out = "integrate.xyi", // output files 
+               *log = "integrate.log"; // output files
+
+    FILE *ind, * ino1, *ino2, *ou, *lo;
+
+    if ((buf = (char * ) malloc(80 * sizeof(char))) == NULL) {
+        error("\nNot enough memory to allocate BUF\n");
+        exit(1);
+    }
+
+    //  printf("argc: %d\n",argc);  
+    //  printf("%s\n",argv[0]);
+    //  printf("%s\n",argv[1]);  
+    //  printf("%s\n",argv[2]);    
+    //  printf("%s\n",argv[3]);   
 
     printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
             \n +                         INTEGRATE                           +\
@@ -1046,6 +3248,11 @@ int integrate(int argc, char * argv[]) {
          \n              dominant.xyd  - (1st) dominant DSs data file   \
          \n           asc_master.porb  - (2nd) ASC polynomial orbit file\
          \n           dsc_master.porb  - (3rd) DSC polynomial orbit file\n\
+         \n    options:\
+         \n    --tol=1e-11      - tolerance of the zero-Doppler solver\
+         \n    --max_iter=50    - iterations of the zero-Doppler solver\
+         \n    --warm           - solve the points in the order of their\
+         \n                       azimuth time, each from the previous one\n\
          \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
         exit(1);
     }
@@ -1078,53 +3285,136 @@ int integrate(int argc, char * argv[]) {
     fprintf(lo, "\n  inputs:   %s\n          %s\n          %s", argv[2], argv[3], argv[4]);
     fprintf(lo, "\n\n outputs:  %s\n           %s\n", out, log);
 
+    if (get_option(argc, argv, "--tol") != NULL)
+        sscanf(get_option(argc, argv, "--tol"), "%lf", & tol);
+    if (get_option(argc, argv, "--max_iter") != NULL)
+        sscanf(get_option(argc, argv, "--max_iter"), "%d", & max_iter);
+    warm = get_flag(argc, argv, "--warm");
+
     // -----------------------------------------------------------   
-    fscanf(ino1, "%d %lf %lf", & dop1, & ft1, & lt1); // read orbit
-    dop1++;
-    if ((pol1 = (double * ) malloc(dop1 * 3 * sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate POL1\n");
-        exit(1);
-    }
-    for (i = 0; i < 3; i++)
-        for (j = 0; j < dop1; j++)
-            fscanf(ino1, " %lf", (pol1 + i * dop1 + j));
     fclose(ino1);
-    // ---------------------------------------
-    fscanf(ino2, "%d %lf %lf", & dop2, & ft2, & lt2); // read orbit
-    dop2++;
-    if ((pol2 = (double * ) malloc(dop2 * 3 * sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate POL2\n");
-        exit(1);
-    }
-    for (i = 0; i < 3; i++)
-        for (j = 0; j < dop2; j++)
-            fscanf(ino2, " %lf", (pol2 + i * dop2 + j));
     fclose(ino2);
+    read_porb(argv[3], & orb1); // read orbit
+    read_porb(argv[4], & orb2); // read orbit
     // -------------------------------------------------------------
 
     //    details:
     //    fprintf(lo,"    longitude       latitude       height     azi1   inc1    v1    azi2    inc2    v2    strike & tilt   tilt  strike & tilt\n");
     //    fprintf(lo,"                                                                                             azimuts     angle   movements\n\n"); 
 
-    while (fscanf(ind, "%f %f %f %f %f", &la, &fi, &he, &v1, &v2) > 0) {
-        ps.f = fi / 180.0 * M_PI;
-        ps.l = la / 180.0 * M_PI;
-        ps.h = he;
-        ell_cart(&ps);
+    while (fscanf(ind, "%f %f %f %f %f", &la, &fi, &he, &v1, &v2) > 0) n++;
+    rewind(ind);
+
+    if ((pts = (psxyd * ) malloc((n + 1) * sizeof(psxyd))) == NULL ||
+        (ord = (pstime * ) malloc((n + 1) * sizeof(pstime))) == NULL ||
+        (vel = (float * ) malloc(2 * (n + 1) * sizeof(float))) == NULL) {
+        error("\nNot enough memory to allocate points\n");
+        exit(1);
+    }
+
+    azimuth_model(& orb1, & am1);
+    azimuth_model(& orb2, & am2);
+
+    for (i = 0; i < n; i++) {
+        fscanf(ind, "%f %f %f %f %f", &la, &fi, &he, &v1, &v2);
+        pts[i].la = la;
+        pts[i].fi = fi;
+        pts[i].he = he;
+        pts[i].v1 = v1;
+        pts[i].v2 = v2;
+
+        ord[i].i = i;
+        ord[i].t = 0.0;
+        if (warm) {
+            ps[0].f = fi / 180.0 * M_PI;
+            ps[0].l = la / 180.0 * M_PI;
+            ps[0].h = he;
+            ell_cart(ps);
+            ord[i].t = azimuth_time(& am1, ps);
+        }
+    }
+    fclose(ind);
+
+    // neighbours in azimuth time have almost the same zero-Doppler times
+    if (warm) qsort(ord, n, sizeof(pstime), cmp_time);
+
+    // groups of points are solved together, in the vector lanes
+    for (k = 0; k < n; k += orbit_lanes) {
+        m = n - k < orbit_lanes ? n - k : orbit_lanes;
+
+        for (j = 0; j < m; j++) {
+            i = ord[k + j].i;
+            ps[j].f = pts[i].fi / 180.0 * M_PI;
+            ps[j].l = pts[i].la / 180.0 * M_PI;
+            ps[j].h = pts[i].he;
+            ell_cart(ps + j);
+
+            xyz[3 * j] = ps[j].x;
+            xyz[3 * j + 1] = ps[j].y;
+            xyz[3 * j + 2] = ps[j].z;
+
+            if (warm) {
+                // previous solutions shifted by the change of the model
+                c1[j] = azimuth_time(& am1, ps + j);
+                c2[j] = azimuth_time(& am2, ps + j);
+                t1[j] = k > 0 ? r1 + c1[j] - p1 : c1[j];
+                t2[j] = k > 0 ? r2 + c2[j] - p2 : c2[j];
+            }
+            else
+                t1[j] = t2[j] = NAN;
+        }
+
+        // cold starts of every 16th group for the profile
+        if (warm && (k / orbit_lanes) % 16 == 0) {
+            for (j = 0; j < m; j++) tc[j] = NAN;
+            cold += closest_appr_batch(& orb1, m, xyz, tc, sat1, tol,
+                                       max_iter);
+            for (j = 0; j < m; j++) tc[j] = NAN;
+            cold += closest_appr_batch(& orb2, m, xyz, tc, sat2, tol,
+                                       max_iter);
+            ncold += m;
+        }
+
+        iter += closest_appr_batch(& orb1, m, xyz, t1, sat1, tol, max_iter);
+        iter += closest_appr_batch(& orb2, m, xyz, t2, sat2, tol, max_iter);
+
+        if (warm) {
+            r1 = t1[m - 1];
+            r2 = t2[m - 1];
+            p1 = c1[m - 1];
+            p2 = c2[m - 1];
+        }
+
+        for (j = 0; j < m; j++) {
+            i = ord[k + j].i;
 
-        closest_appr(pol1, dop1, ft1, lt1, &ps, &sat);
-        azim_elev(ps, sat, &azi1, &inc1);
+            sat.x = sat1[3 * j];
+            sat.y = sat1[3 * j + 1];
+            sat.z = sat1[3 * j + 2];
+            azim_elev(ps[j], sat, &azi1, &inc1);
 
-        closest_appr(pol2, dop2, ft2, lt2, &ps, &sat);
-        azim_elev(ps, sat, & azi2, & inc2);
+            sat.x = sat2[3 * j];
+            sat.y = sat2[3 * j + 1];
+            sat.z = sat2[3 * j + 2];
+            azim_elev(ps[j], sat, & azi2, & inc2);
 
-        movements(ps, azi1, inc1, v1, azi2, inc2, v2, & up, & east, lo);
+            movements(ps[j], azi1, inc1, pts[i].v1, azi2, inc2, pts[i].v2,
+                      & up, & east, lo);
 
-        fprintf(ou, "%16.7e %15.7e %9.3f %7.3f %7.3f\n", la, fi, he, east, up);
-        n++;
-        if ((n % 1000) == 0) printf("\n %6d ...", n);
+            vel[2 * i] = east;
+            vel[2 * i + 1] = up;
+        }
+        if (((k + m) % 1000) < m) printf("\n %6d ...", (k + m) / 1000 * 1000);
     }
 
+    for (i = 0; i < n; i++)
+        fprintf(ou, "%16.7e %15.7e %9.3f %7.3f %7.3f\n", pts[i].la,
+                pts[i].fi, pts[i].he, vel[2 * i], vel[2 * i + 1]);
+
+    free(pts);
+    free(ord);
+    free(vel);
+
     printf("\n %6d", n);
 
     printf("\n\n Records of %s file:\n", out);
@@ -1132,6 +3422,12 @@ int integrate(int argc, char * argv[]) {
     printf("\n (     degree          m       mm/year )");
 
     fprintf(lo, "\n DSs  %6d\n", n);
+    fprintf(lo, "\n zero-Doppler iterations per solve: %.2f\n",
+            n > 0 ? iter / (2.0 * n) : 0.0);
+    if (warm && ncold > 0 && iter > 0)
+        fprintf(lo, " cold start on %d sampled DSs: %.2f, speedup %.2f\n",
+                ncold, cold / (2.0 * ncold),
+                (cold / (2.0 * ncold)) / (iter / (2.0 * n)));
     fprintf(lo, "\n Records of %s file:\n", out);
     fprintf(lo, "\n longitude latitude  height  ew_v   up_v");
     fprintf(lo, "\n (     degree          m       mm/year )\n\n");
@@ -1145,16 +3441,279 @@ int integrate(int argc, char * argv[]) {
 
 } // end integrate
 
+int integrate_grid(int argc, char * argv[]) {
+    int i, n1, n2, nla, nfi, nval = 0, max_iter = Doppler_maxiter;
+    long iter = 0;
+    orbit_poly orb1, orb2;
+    double step, la0, la1, fi0, fi1, dm, tol = Doppler_tol;
+
+    float la, fi, he, dhe, ve, * raster;
+    psxys * indata;
+    psgrid grid;
+
+    char *out = "integrate_grid.dat", *hdr = "integrate_grid.hdr",
+         *log = "integrate_grid.log";
+    FILE *in1, *in2, *ou, *lo;
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                      INTEGRATE_GRID                         +\
+            \n +   east-west and up-down velocities at the nodes of a grid   +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 6) {
+        printf(
+        "\n usage:                                                      \n\
+         \n    daisy integrate_grid asc_data.xys dsc_data.xys asc_master.porb\
+         \n                         dsc_master.porb 100 0.001\n\
+         \n              asc_data.xys  - (1st) ascending  data file\
+         \n              dsc_data.xys  - (2nd) descending data file\
+         \n           asc_master.porb  - (3rd) ASC polynomial orbit file\
+         \n           dsc_master.porb  - (4th) DSC polynomial orbit file\
+         \n                       100  - (5th) radius of interpolation (m)\
+         \n                     0.001  - (6th) grid spacing (degree)\n\
+         \n    options:\
+         \n    --extent=la_min,la_max,fi_min,fi_max - grid extent (degree),\
+         \n                  default: extent of the PSs\
+         \n    --tol=1e-11      - tolerance of the zero-Doppler solver\
+         \n    --max_iter=50    - iterations of the zero-Doppler solver\n\
+         \n    output: integrate_grid.dat - east and up velocities (mm/year)\
+         \n            as 4 byte floats, two bands one after the other, rows\
+         \n            from north to south, NaN where ascending or\
+         \n            descending PSs are missing; integrate_grid.hdr - ENVI\
+         \n            header\n\
+         \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    if ((in1 = fopen(argv[2], "rt")) == NULL) {
+        errorln("\n  %s data file not found !", argv[2]);
+        exit(1);
+    }
+    if ((in2 = fopen(argv[3], "rt")) == NULL) {
+        errorln("\n  %s data file not found !", argv[3]);
+        exit(1);
+    }
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  LOG data file not found !\n");
+        exit(1);
+    }
+
+    read_porb(argv[4], & orb1);
+    read_porb(argv[5], & orb2);
+
+    sscanf(argv[6], "%f", & la);
+    dm = la / R * C * la / R * C;
+    sscanf(argv[7], "%lf", & step);
+
+    printf("\n  inputs:   %s\n          %s\n          %s\n          %s",
+           argv[2], argv[3], argv[4], argv[5]);
+    printf("\n\n outputs:  %s\n           %s\n           %s\n", out, hdr, log);
+
+    fprintf(lo, "\n %s %s %s %s %s %s %s %s\n", argv[0], argv[1], argv[2],
+            argv[3], argv[4], argv[5], argv[6], argv[7]);
+    fprintf(lo, "\n  inputs:   %s\n          %s\n          %s\n          %s",
+            argv[2], argv[3], argv[4], argv[5]);
+    fprintf(lo, "\n\n outputs:  %s\n           %s\n", out, hdr);
+
+    // -----------------------------------------------------------
+    n1 = 0;
+    while (fscanf(in1, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n1++;
+    rewind(in1);
+
+    n2 = 0;
+    while (fscanf(in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe) > 0) n2++;
+    rewind(in2);
+
+    if ((indata = (psxys * ) malloc((n1 + n2 + 1) * sizeof(psxys))) == NULL) {
+        error("\nNot enough memory to allocate indata\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n1 + n2; i++) {
+        fscanf(i < n1 ? in1 : in2, "%e %e %e %e %e", & la, & fi, & ve, & he, & dhe);
+        (indata + i)->ni = i < n1 ? 1 : 2;
+        (indata + i)->la = la;
+        (indata + i)->fi = fi;
+        (indata + i)->he = he + dhe;
+        (indata + i)->ve = ve;
+    }
+    fclose(in1);
+    fclose(in2);
+
+    grid_build(& grid, indata, n1 + n2, sqrt(dm));
+
+    if (get_option(argc, argv, "--extent") != NULL) {
+        if (sscanf(get_option(argc, argv, "--extent"), "%lf,%lf,%lf,%lf",
+                   & la0, & la1, & fi0, & fi1) != 4
+            || !(la0 < la1) || !(fi0 < fi1)) {
+            errorln("\n  Wrong --extent: %s, it should be la_min,la_max,"
+                    "fi_min,fi_max !\n", get_option(argc, argv, "--extent"));
+            exit(1);
+        }
+    }
+    else {
+        la0 = grid.la0;
+        fi0 = grid.fi0;
+        la1 = grid.la0 + grid.nla * grid.cell;
+        fi1 = grid.fi0 + grid.nfi * grid.cell;
+    }
+
+    if (get_option(argc, argv, "--tol") != NULL)
+        sscanf(get_option(argc, argv, "--tol"), "%lf", & tol);
+    if (get_option(argc, argv, "--max_iter") != NULL)
+        sscanf(get_option(argc, argv, "--max_iter"), "%d", & max_iter);
+
+    nla = (int) floor((la1 - la0) / step) + 1;
+    nfi = (int) floor((fi1 - fi0) / step) + 1;
+
+    printf("\n Grid: %d x %d nodes, spacing %.3e (degree)\n", nla, nfi, step);
+    fprintf(lo, "\n\n Grid: %d x %d nodes, spacing %.3e (degree)", nla, nfi, step);
+    fprintf(lo, "\n upper left node: %.8f %.8f (degree)\n", la0, fi0 + (nfi - 1) * step);
+
+    if ((raster = (float * ) malloc(2 * (size_t) nla * nfi * sizeof(float))) == NULL) {
+        error("\nNot enough memory to allocate raster\n");
+        exit(1);
+    }
+
+    printf("\n Interpolation ...\n");
+
+    // rows run from north to south
+    #pragma omp parallel reduction(+:nval, iter)
+    {
+        int ii, jj, kk, m, * nbr = NULL, nnbr = 0, nbuf = 0, ps1;
+        double azi1, inc1, azi2, inc2, t;
+        float up, east;
+        psxys * buf = NULL;
+        psxyd dom;
+        pwsum sh1, sh2;
+        station node, sat;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (jj = 0; jj < nfi; jj++)
+            for (ii = 0; ii < nla; ii++) {
+                node.l = la0 + ii * step;
+                node.f = fi0 + (nfi - 1 - jj) * step;
+
+                raster[(size_t) jj * nla + ii] =
+                raster[(size_t) (nfi + jj) * nla + ii] = NAN;
+
+                m = grid_query(& grid, indata, node.l, node.f, dm, & nbr, & nnbr);
+                if (m == 0) continue;
+
+                // ascending PSs first, as in estim_dominant
+                qsort(nbr, m, sizeof(int), cmp_int);
+
+                if (m > nbuf) {
+                    nbuf = m;
+                    if ((buf = (psxys * ) realloc(buf, nbuf * sizeof(psxys))) == NULL) {
+                        error("\nNot enough memory to allocate buffer\n");
+                        exit(1);
+                    }
+                }
+
+                pw_init(& sh1);
+                pw_init(& sh2);
+                for (kk = 0, ps1 = 0; kk < m; kk++) {
+                    buf[kk] = indata[nbr[kk]];
+                    if (nbr[kk] < n1) {
+                        pw_add(& sh1, buf[kk].he);
+                        ps1++;
+                    } else
+                        pw_add(& sh2, buf[kk].he);
+                }
+                if (ps1 == 0 || ps1 == m) continue;
+
+                // node height is the mean of ascending and descending heights
+                node.h = (pw_total(& sh1) / ps1 + pw_total(& sh2) / (m - ps1)) / 2.0;
+                node.f = node.f / 180.0 * M_PI;
+                node.l = node.l / 180.0 * M_PI;
+                ell_cart(& node);
+
+                estim_velocities(buf, ps1, m - ps1, & node, & dom);
+
+                t = NAN;
+                iter += closest_appr(& orb1, & node, & sat, & t, tol,
+                                     max_iter);
+                azim_elev(node, sat, & azi1, & inc1);
+
+                t = NAN;
+                iter += closest_appr(& orb2, & node, & sat, & t, tol,
+                                     max_iter);
+                azim_elev(node, sat, & azi2, & inc2);
+
+                movements(node, azi1, inc1, dom.v1, azi2, inc2, dom.v2,
+                          & up, & east, lo);
+
+                raster[(size_t) jj * nla + ii] = east;
+                raster[(size_t) (nfi + jj) * nla + ii] = up;
+                nval++;
+            }
+
+        free(nbr);
+        free(buf);
+    }
+
+    if ((ou = fopen(out, "wb")) == NULL) {
+        error("\n  OUT data file not found !\n");
+        exit(1);
+    }
+    if (fwrite(raster, sizeof(float), 2 * (size_t) nla * nfi, ou) != 2 * (size_t) nla * nfi) {
+        errorln("\n  Writing of %s failed !", out);
+        exit(1);
+    }
+    fclose(ou);
+
+    if ((ou = fopen(hdr, "wt")) == NULL) {
+        error("\n  HDR data file not found !\n");
+        exit(1);
+    }
+    // map info refers to the upper left corner of the upper left node
+    fprintf(ou, "ENVI\ndescription = {daisy integrate_grid}\n");
+    fprintf(ou, "samples = %d\nlines = %d\nbands = 2\nheader offset = 0\n", nla, nfi);
+    fprintf(ou, "file type = ENVI Standard\ndata type = 4\ninterleave = bsq\n");
+    fprintf(ou, "byte order = %d\n", * (unsigned char * ) & (int){1} == 1 ? 0 : 1);
+    fprintf(ou, "map info = {Geographic Lat/Lon, 1, 1, %.10f, %.10f, %.10e, %.10e, WGS-84}\n",
+            la0 - step / 2.0, fi0 + (nfi - 1) * step + step / 2.0, step, step);
+    fprintf(ou, "band names = {east_v, up_v}\ndata ignore value = NaN\n");
+    fclose(ou);
+
+    printf("\n Nodes with velocities %d of %d\n", nval, nla * nfi);
+    fprintf(lo, "\n Nodes with velocities %d of %d\n", nval, nla * nfi);
+    fprintf(lo, "\n zero-Doppler iterations per solve: %.2f\n",
+            nval > 0 ? iter / (2.0 * nval) : 0.0);
+    fprintf(lo, "\n Bands of %s file: east_v up_v (mm/year)\n\n", out);
+    fclose(lo);
+
+    grid_free(& grid);
+    free(raster);
+    free(indata);
+    free_porb(& orb1);
+    free_porb(& orb2);
+
+    printf(
+    "\n\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+     \n +                     END INTEGRATE_GRID                        +\
+     \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+
+} // end integrate_grid
+
 int poly_orbit(int argc, char * argv[]) {
-    int i, dop, // deegre of polinomials
-    ndp; // number of orbit records
+    int i, j, k, kind, dop, // deegre of polinomials
+    ndp, // number of orbit records
+    nseg = 1, // number of spline segments
+    hermite, nvel = 0, // interpolation, number of records with velocities
+    cache; // write a binary orbit cache too
     torb * orb; // tabular orbit data
-    double * X, t, x, y, z;
+    double * X, * sd, * sv, mu0[3], seg = 0.0;
+    orbit_poly fitted;
+    meta_file * in; // mapped .res or .par file
 
-    char *out, *buf, *head;
+    char *out;
     char *log; // log output file
 
-    FILE * in , * ou, * lo;
+    FILE * ou, * lo;
 
     printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
             \n +                       POLY_ORBIT                      +\
@@ -1167,6 +3726,18 @@ int poly_orbit(int argc, char * argv[]) {
                 \n                    daisy poly_orbit dsc_master.res 4\
                 \n\n          asc_master.res or dsc_master.res - input files\
                 \n          4                                - degree     \n\
+                \n          --chebyshev - fit Chebyshev series instead of\
+                \n                        polynomials in time           \
+                \n          --spline    - fit a cubic (3) or quintic (5)\
+                \n                        spline with uniform segments  \
+                \n          --segment=  - length of the spline segments \
+                \n                        in seconds                    \
+                \n          --hermite   - cubic Hermite interpolation of\
+                \n                        positions and velocities (t x \
+                \n                        y z vx vy vz records), degree \
+                \n                        is not used                   \
+                \n          --cache     - write a binary orbit cache    \
+                \n                        (.borb) next to the .porb file\n\
                 \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
         exit(1);
     }
@@ -1185,32 +3756,35 @@ int poly_orbit(int argc, char * argv[]) {
         exit(1);
     }
 
-    if ((buf = (char * ) malloc(80 * sizeof(char))) == NULL) {
-        error("\nNot enough memory to allocate BUF\n");
-        exit(1);
+    sscanf(argv[3], "%d", & dop);
+    kind = get_flag(argc, argv, "--chebyshev") ? orbit_chebyshev
+                                               : orbit_monomial;
+    if (get_flag(argc, argv, "--spline")) {
+        kind = orbit_spline;
+        
+        if (dop != 3 && dop != 5) {
+            error("\n Error - spline degree must be 3 or 5 ! \n");
+            exit(1);
+        }
+        if (get_option(argc, argv, "--segment") != NULL)
+            sscanf(get_option(argc, argv, "--segment"), "%lf", & seg);
     }
-    if ((head = (char * ) malloc(80 * sizeof(char))) == NULL) {
-        error("\nNot enough memory to allocate HEAD\n");
-        exit(1);
+    cache = get_flag(argc, argv, "--cache");
+    if ((hermite = get_flag(argc, argv, "--hermite"))) {
+        kind = orbit_spline;
+        dop = 3;
     }
 
-    head = "NUMBER_OF_DATAPOINTS:";
-    sscanf(argv[3], "%d", & dop);
-
     //  sprintf(out,"%s%s",argv[1],"o"); 
     sprintf(out, "%s", argv[2]);
     change_ext(out, "porb");
 
     sprintf(log, "%s%s", out, ".log");
 
-    if (( in = fopen(argv[2], "rt")) == NULL) {
+    if (( in = meta_open(argv[2])) == NULL) {
         error("\n  1. Data file not found !\n");
         exit(1);
     }
-    if ((ou = fopen(out, "w+t")) == NULL) {
-        error("\n  3. Data file not found !\n");
-        exit(1);
-    }
     if ((lo = fopen(log, "w+t")) == NULL) {
         error("\n  4. Data file not found !\n");
         exit(1);
@@ -1225,50 +3799,171 @@ int poly_orbit(int argc, char * argv[]) {
     printf("\n output: %s", out);
     printf("\n degree: %d\n", dop);
 
-    while (fscanf( in , "%s", buf) > 0 && strncmp(buf, head, 21) != 0);
-    fscanf( in , "%d", & ndp);
+    if (kind == orbit_chebyshev) {
+        fprintf(lo, "  basis: chebyshev\n");
+        printf("  basis: chebyshev\n");
+    }
+    else if (hermite) {
+        fprintf(lo, "  basis: hermite\n");
+        printf("  basis: hermite\n");
+    }
+    else if (kind == orbit_spline) {
+        fprintf(lo, "  basis: spline\n");
+        printf("  basis: spline\n");
+    }
+
+    // precise orbits of a .res file (t x y z, optionally vx vy vz) or
+    // state vectors of a .par file, see satorbit/metafile.cpp
+    if ((ndp = meta_state_vectors( in , NULL, 0, NULL)) < 1) {
+        errorln("\n  No orbit records in %s !", argv[2]);
+        exit(1);
+    }
 
     if ((orb = (torb * ) malloc(ndp * sizeof(torb))) == NULL) {
         error("\nNot enough memory to allocate orb\n");
         exit(1);
     }
-    if ((X = (double * ) calloc((dop + 1), sizeof(double))) == NULL) {
-        error("\nNot enough memory to allocate X\n");
+    if ((sv = (double * ) malloc(7 * ndp * sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate state vectors\n");
         exit(1);
     }
 
+    if (meta_state_vectors( in , sv, ndp, & nvel) != ndp) {
+        errorln("\n  Wrong orbit records in %s !", argv[2]);
+        exit(1);
+    }
+    meta_close( in );
+
     for (i = 0; i < ndp; i++) {
-        fscanf( in , "%lf %lf %lf %lf", & t, & x, & y, & z);
-        (orb + i)->t = t;
-        (orb + i)->x = x;
-        (orb + i)->y = y;
-        (orb + i)->z = z;
+        (orb + i)->t = sv[7 * i];
+        (orb + i)->x = sv[7 * i + 1];
+        (orb + i)->y = sv[7 * i + 2];
+        (orb + i)->z = sv[7 * i + 3];
+    }
+
+    if (hermite) {
+        if (nvel < ndp) {
+            errorln("\n Error - %d orbit records have no velocities ! \n",
+                    ndp - nvel);
+            exit(1);
+        }
+        nseg = ndp - 1;
+    }
+    else if (kind == orbit_spline) {
+        // by default about two state vectors per control point
+        if (seg > 0.0)
+            nseg = (int) ceil(((orb + ndp - 1)->t - orb->t) / seg);
+        else
+            nseg = (ndp - dop - 1) / 2;
+        if (nseg < 1) nseg = 1;
+
+        fprintf(lo, "  segments: %d\n", nseg);
+        printf("  segments: %d\n", nseg);
+    }
+
+    if ((X = (double * ) calloc(3 * nseg * (dop + 1), sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate X\n");
+        exit(1);
+    }
+    if ((sd = (double * ) calloc(3 * (dop + 1), sizeof(double))) == NULL) {
+        error("\nNot enough memory to allocate SD\n");
+        exit(1);
+    }
+
+    // fit before the output is opened, a failed fit leaves no .porb file
+    if (hermite) {
+        if (orbit_hermite(ndp, sv, X) != 0) {
+            error("\n Error - orbit records are not evenly spaced in time ! \n");
+            exit(1);
+        }
+        mu0[0] = mu0[1] = mu0[2] = 0.0;
     }
-    fprintf(ou, "%3d\n", dop);
+    else if (kind == orbit_spline) {
+        spline_fit(ndp, dop, nseg, orb, X, mu0);
+    }
+    else {
+        // x, y and z in one go
+        poly_fit(ndp, dop + 1, orb, kind, X, mu0, sd);
+    }
+
+    if ((ou = fopen(out, "w+t")) == NULL) {
+        error("\n  3. Data file not found !\n");
+        exit(1);
+    }
+
+    if (kind == orbit_chebyshev)
+        fprintf(ou, "%3d chebyshev\n", dop);
+    else if (kind == orbit_spline)
+        fprintf(ou, "%3d spline %d\n", dop, nseg);
+    else
+        fprintf(ou, "%3d\n", dop);
     fprintf(ou, "%13.5f\n", orb->t);
     fprintf(ou, "%13.5f\n", (orb + ndp - 1)->t);
-    //
-    printf("\n fit of X coordinates:");
-    fprintf(lo, "\n fit of X coordinates:");
-    poly_fit(ndp, dop + 1, orb, X, 'x', lo); // ***********
-    for (i = 0; i < (dop + 1); i++) fprintf(ou, " %23.15e", * (X + i));
-    fprintf(ou, "\n");
 
-    printf("\n\n fit of Y coordinates:");
-    fprintf(lo, "\n\n fit of Y coordinates:");
-    poly_fit(ndp, dop + 1, orb, X, 'y', lo); // ***********
-    for (i = 0; i < (dop + 1); i++) fprintf(ou, " %23.15e", * (X + i));
+    if (hermite) {
+        for (j = 0; j < 3; j++) {
+            for (k = 0; k < nseg; k++) {
+                for (i = 0; i < 4; i++)
+                    fprintf(ou, " %23.15e", * (X + (j * nseg + k) * 4 + i));
+                fprintf(ou, "\n");
+            }
+        }
+    }
+    else if (kind == orbit_spline) {
+        for (j = 0; j < 3; j++) {
+            printf("\n fit of %c coordinates:", "XYZ"[j]);
+            fprintf(lo, "%s fit of %c coordinates:", j ? "\n\n" : "\n",
+                    "XYZ"[j]);
+            fprintf(lo, "  mu0= %8.4lf dof= %d", mu0[j], ndp - nseg - dop);
+            printf("\n mu0= %8.4lf     dof= %d\n", mu0[j], ndp - nseg - dop);
+            
+            // one line per segment
+            for (k = 0; k < nseg; k++) {
+                for (i = 0; i < (dop + 1); i++)
+                    fprintf(ou, " %23.15e",
+                            * (X + (j * nseg + k) * (dop + 1) + i));
+                fprintf(ou, "\n");
+            }
+        }
+    }
+    else {
+        for (j = 0; j < 3; j++) {
+            printf("%s fit of %c coordinates:", j ? "\n\n" : "\n", "XYZ"[j]);
+            fprintf(lo, "%s fit of %c coordinates:", j ? "\n\n" : "\n",
+                    "XYZ"[j]);
+            print_fit(ndp, dop + 1, X + j * (dop + 1), mu0[j],
+                      sd + j * (dop + 1), lo);
+            
+            for (i = 0; i < (dop + 1); i++)
+                fprintf(ou, " %23.15e", * (X + j * (dop + 1) + i));
+            fprintf(ou, "\n");
+        }
+    }
     fprintf(ou, "\n");
 
-    printf("\n\n fit of Z coordinates:");
-    fprintf(lo, "\n\n fit of Z coordinates:");
-    poly_fit(ndp, dop + 1, orb, X, 'z', lo); // ***********
-    for (i = 0; i < (dop + 1); i++) fprintf(ou, " %23.15e", * (X + i));
-    fprintf(ou, "\n\n");
-
     fprintf(lo, "\n\n");
 
-    fclose( in );
+    if (cache) {
+        fitted.kind = kind;
+        fitted.n = dop + 1;
+        fitted.nseg = nseg;
+        fitted.t0 = orb->t;
+        fitted.t1 = (orb + ndp - 1)->t;
+        fitted.coeffs = X;
+        fitted.dcoeffs = NULL;
+        fitted.map = NULL;
+        
+        change_ext(out, "borb");
+        
+        if (orbit_cache_write(out, & fitted, mu0) != 0) {
+            errorln("\n  Cannot write orbit cache %s !", out);
+            exit(1);
+        }
+        fprintf(lo, "  cache: %s\n", out);
+        printf("\n\n  cache: %s", out);
+    }
+
+    free(sv);
     fclose(ou);
     fclose(lo);
 
@@ -1278,6 +3973,118 @@ int poly_orbit(int argc, char * argv[]) {
 
 } // end poly_orbit
 
+int catalog_orbits(int argc, char * argv[]) {
+    int i, kind, dop, // degree of polynomials
+    hermite, n = 0, cap = 0, nfit;
+    double seg = 0.0;
+    char * * files = NULL, log[256];
+    orbit_entry * entries;
+    static char const * status[] = {"ok", "unreadable", "no orbit",
+                                    "no date", "fit failed", "duplicate"};
+
+    FILE * lo;
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                    CATALOG_ORBITS                     +\
+            \n +   orbits of a whole stack are fitted in parallel and  +\
+            \n +           stored in one catalogue by date             +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+
+    if (argc - Minarg < 3) {
+        printf("\n          usage:    daisy catalog_orbits stack.corb 4 SLC\
+                \n                 or\
+                \n                    daisy catalog_orbits stack.corb 4 *.res\
+                \n\n          stack.corb - output catalogue             \
+                \n          4          - degree                       \
+                \n          SLC        - .res or .par files, directories \
+                \n                       are searched recursively      \n\
+                \n          --chebyshev, --spline, --segment= and       \
+                \n          --hermite as for poly_orbit                 \n\
+                \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+        exit(1);
+    }
+
+    sscanf(argv[3], "%d", & dop);
+    kind = get_flag(argc, argv, "--chebyshev") ? orbit_chebyshev
+                                               : orbit_monomial;
+    if (get_flag(argc, argv, "--spline")) {
+        kind = orbit_spline;
+
+        if (dop != 3 && dop != 5) {
+            error("\n Error - spline degree must be 3 or 5 ! \n");
+            exit(1);
+        }
+        if (get_option(argc, argv, "--segment") != NULL)
+            sscanf(get_option(argc, argv, "--segment"), "%lf", & seg);
+    }
+    if ((hermite = get_flag(argc, argv, "--hermite"))) {
+        kind = orbit_spline;
+        dop = 3;
+    }
+
+    for (i = 4; i < argc; i++)
+        if (strncmp(argv[i], "--", 2) != 0)
+            collect_orbits(argv[i], & files, & n, & cap);
+
+    if (n == 0) {
+        error("\n  No .res or .par files found !\n");
+        exit(1);
+    }
+
+    if ((entries = (orbit_entry * ) malloc(n * sizeof(orbit_entry))) == NULL) {
+        error("\nNot enough memory to allocate entries\n");
+        exit(1);
+    }
+
+    sprintf(log, "%.240s%s", argv[2], ".log");
+
+    if ((lo = fopen(log, "w+t")) == NULL) {
+        error("\n  Log file cannot be created !\n");
+        exit(1);
+    }
+
+    fprintf(lo, "\n %s %s %s %s\n", argv[0], argv[1], argv[2], argv[3]);
+    fprintf(lo, "\n output: %s", argv[2]);
+    fprintf(lo, "\n degree: %d", dop);
+    fprintf(lo, "\n  files: %d\n", n);
+
+    printf("\n output: %s", argv[2]);
+    printf("\n degree: %d", dop);
+    printf("\n  files: %d\n", n);
+
+    if ((nfit = orbit_catalog_build(argv[2], n, (char const * const * ) files,
+                                    kind, dop, seg, hermite, entries)) < 0) {
+        errorln("\n  %s cannot be written !", argv[2]);
+        exit(1);
+    }
+
+    fprintf(lo, "\n   date    status       nsv  dof    mu0 x    mu0 y    mu0 z  file\n");
+    for (i = 0; i < n; i++) {
+        fprintf(lo, "%8d  %-11s %4d %4d %8.4lf %8.4lf %8.4lf  %s\n",
+                entries[i].date, status[entries[i].status], entries[i].nsv,
+                entries[i].dof, entries[i].mu0[0], entries[i].mu0[1],
+                entries[i].mu0[2], files[i]);
+        if (entries[i].status != catalog_ok)
+            printf("\n  %s: %s", files[i], status[entries[i].status]);
+    }
+
+    fprintf(lo, "\n catalogued: %d of %d\n", nfit, n);
+    printf("\n\n catalogued: %d of %d\n", nfit, n);
+
+    fclose(lo);
+
+    for (i = 0; i < n; i++)
+        free(files[i]);
+    free(files);
+    free(entries);
+
+    printf("\n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\
+            \n +                  END CATALOG_ORBITS                   +\
+            \n +++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+
+    return (0);
+} // end catalog_orbits
+
 /*****************
  * Main function *
  *****************/
@@ -1301,18 +4108,39 @@ int main(int argc, char * * argv) {
         return (-1);
     }
 
-    if (Module_Select("data_select") || Module_Select("DATA_SELECT"))
+    if (Module_Select("mosaic") || Module_Select("MOSAIC"))
+        return mosaic(argc, argv);
+
+    else if (Module_Select("clip") || Module_Select("CLIP"))
+        return clip(argc, argv);
+
+    else if (Module_Select("data_select") || Module_Select("DATA_SELECT"))
         return data_select(argc, argv);
 
+    else if (Module_Select("neighbours") || Module_Select("NEIGHBOURS"))
+        return neighbours(argc, argv);
+
     else if (Module_Select("dominant") || Module_Select("DOMINANT"))
         return dominant(argc, argv);
 
+    else if (Module_Select("dominant_update") || Module_Select("DOMINANT_UPDATE"))
+        return dominant_update(argc, argv);
+
     else if (Module_Select("poly_orbit") || Module_Select("POLY_ORBIT"))
         return poly_orbit(argc, argv);
 
+    else if (Module_Select("catalog_orbits") || Module_Select("CATALOG_ORBITS"))
+        return catalog_orbits(argc, argv);
+
     else if (Module_Select("integrate") || Module_Select("INTEGRATE"))
         return integrate(argc, argv);
 
+    else if (Module_Select("zero_select") || Module_Select("ZERO_SELECT"))
+        return zero_select(argc, argv);
+
+    else if (Module_Select("integrate_grid") || Module_Select("INTEGRATE_GRID"))
+        return integrate_grid(argc, argv);
+
     else {
         errorln("Unrecognized module: %s", argv[1]);
         errorln("Modules to choose from: %s.", Modules);
@@ -0,0 +1,173 @@
+# DAISY
+# Copyright (C) 2018  István Bozsó
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Regression checks of daisy on the data of daisy_test_data. Run it from
+src/daisy after compile.py; every check prints ok or FAILED and the exit
+status is the number of failed checks.
+"""
+
+import sys
+from random import Random
+from os import environ, mkdir
+from os.path import join, abspath
+from shutil import copy
+from filecmp import cmp
+from subprocess import run, DEVNULL
+from tempfile import TemporaryDirectory
+from argparse import ArgumentParser, ArgumentDefaultsHelpFormatter
+
+data = join("..", "..", "daisy_test_data")
+
+def parse_args():
+    
+    ap = ArgumentParser(description=__doc__, formatter_class=
+                        ArgumentDefaultsHelpFormatter)
+    
+    ap.add_argument(
+        "--daisy",
+        default=join("..", "..", "bin", "daisy"),
+        help="The daisy executable to check.")
+    
+    return ap.parse_args()
+
+def daisy(exe, *args, cwd, threads=None):
+    
+    env = dict(environ)
+    
+    if threads is not None:
+        env["OMP_NUM_THREADS"] = str(threads)
+    
+    ret = run((exe,) + args, cwd=cwd, env=env, stdout=DEVNULL,
+              stderr=DEVNULL)
+    
+    if ret.returncode != 0:
+        raise RuntimeError("daisy {} failed in {}".format(args[0], cwd))
+
+def select_data(exe, work):
+    # asc_data.xys and dsc_data.xys, the input of the checks
+    
+    for name in ("asc_data.xy", "dsc_data.xy"):
+        copy(join(data, name), work)
+    
+    daisy(exe, "data_select", "asc_data.xy", "dsc_data.xy", "100", cwd=work)
+
+def dominant(exe, out, *options, prefix="", threads=None):
+    # dominant of asc_data.xys and dsc_data.xys of the parent directory
+    
+    mkdir(out)
+    daisy(exe, "dominant", join("..", prefix + "asc_data.xys"),
+          join("..", prefix + "dsc_data.xys"), "100", *options, cwd=out,
+          threads=threads)
+
+def same_threads(exe, work):
+    """dominant does not depend on the threads"""
+    
+    for method in ("greedy", "grid", "dbscan"):
+        outs = [join(work, "{}_{}".format(method, threads))
+                for threads in (1, 3, 8)]
+        
+        for out, threads in zip(outs, (1, 3, 8)):
+            dominant(exe, out, "--method=" + method, "--save_clusters",
+                     threads=threads)
+        
+        for out in outs[1:]:
+            for name in ("dominant.xyd", "dominant.cls"):
+                if not cmp(join(outs[0], name), join(out, name),
+                           shallow=False):
+                    return "{} of {} differs from {}".format(name, out,
+                                                             outs[0])
+    
+    return None
+
+def split_data(work, seed):
+    # one PS in 20 is left out of the input and added by delta.xys,
+    # another one in 20 is removed by it; the full input is written to
+    # full_*.xys
+    
+    rnd = Random(seed)
+    
+    with open(join(work, "delta.xys"), "w") as delta:
+        for track, name in ((1, "asc_data.xys"), (2, "dsc_data.xys")):
+            with open(join(work, name)) as f, \
+                 open(join(work, "part_" + name), "w") as part, \
+                 open(join(work, "full_" + name), "w") as full:
+                for line in f:
+                    if not line.strip():
+                        continue
+                    
+                    r = rnd.random()
+                    
+                    if r < 0.05:
+                        delta.write("+ {} {}\n".format(track, line.strip()))
+                        full.write(line)
+                    elif r < 0.1:
+                        delta.write("- {} {}\n".format(track, line.strip()))
+                        part.write(line)
+                    else:
+                        part.write(line)
+                        full.write(line)
+
+def sorted_lines(path):
+    
+    with open(path) as f:
+        return sorted(f)
+
+def update_grid(exe, work):
+    """dominant_update is the same as a rerun for grid"""
+    
+    for seed in (1, 2, 3):
+        split_data(work, seed)
+        
+        full, part = (join(work, "{}_{}".format(kind, seed))
+                      for kind in ("full", "part"))
+        
+        dominant(exe, full, "--method=grid", prefix="full_")
+        dominant(exe, part, "--method=grid", "--save_clusters",
+                 prefix="part_")
+        daisy(exe, "dominant_update", "dominant.cls",
+              join("..", "delta.xys"), cwd=part)
+        
+        if sorted_lines(join(full, "dominant.xyd")) \
+           != sorted_lines(join(part, "dominant.xyd")):
+            return "dominant.xyd differs with seed {}".format(seed)
+    
+    return None
+
+checks = (same_threads, update_grid)
+
+def main():
+    
+    args = parse_args()
+    exe = abspath(args.daisy)
+    failed = 0
+    
+    with TemporaryDirectory() as work:
+        select_data(exe, work)
+        
+        for check in checks:
+            msg = check(exe, work)
+            
+            print("{:<50} {}".format(check.__doc__,
+                                     "ok" if msg is None
+                                     else "FAILED: " + msg))
+            failed += msg is not None
+    
+    sys.exit(failed)
+
+
+if __name__ == "__main__":
+    main()
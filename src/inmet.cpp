@@ -1,7 +1,12 @@
 #include <exception>
 #include <iostream>
+#include <limits>
 
 #include "aux.hpp"
+#include "spatial.hpp"
+#include "kriging.hpp"
+#include "raster.hpp"
+#include "lod.hpp"
 // #include "math.hpp"
 
 
@@ -9,6 +14,10 @@ using std::exception;
 using std::cout;
 using std::cerr;
 
+using aux::idx;
+using aux::arr_in;
+using aux::arr_out;
+
 
 extern "C" {
 
@@ -31,6 +40,456 @@ int aaa(aux::Array& a)
     }
 }
 
+/* Spatial index of PSs, coords contain longitude, latitude [degree] and
+ * optionally height [m] in rows. The index is created once and used for
+ * any number of queries. */
+
+int kdtree_new(arr_in coords, void** tree)
+{
+    try {
+        *tree = new spatial::KDTree(spatial::to_points(coords));
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+
+int kdtree_delete(void* tree)
+{
+    delete static_cast<spatial::KDTree*>(tree);
+    return 0;
+}
+
+
+/* k nearest PSs of stations not farther than max_dist [m] (if it is
+ * positive), missing neighbours are marked with -1 and NaN. */
+int kdtree_knn(void const* tree, arr_in coords, idx const k,
+               double const max_dist, arr_out nbr, arr_out dist)
+{
+    try {
+        auto const& kd = *static_cast<spatial::KDTree const*>(tree);
+        auto const sta = spatial::to_points(coords);
+        auto vnbr = nbr.view<int64_t>(2);
+        auto vdist = dist.view<double>(2);
+        auto const ns = idx(sta.size());
+        
+        if (vnbr.shape(0) != ns or vnbr.shape(1) != k or
+            vdist.shape(0) != ns or vdist.shape(1) != k) {
+            throw std::runtime_error("Output arrays should have shape "
+                                     "(number of stations, k)!");
+        }
+        
+        #pragma omp parallel
+        {
+            std::vector<idx> inbr(k);
+            std::vector<double> idist(k);
+            
+            #pragma omp for schedule(dynamic, 16)
+            for (idx ii = 0; ii < ns; ++ii) {
+                auto const m = kd.knn(sta[ii], k, max_dist, inbr.data(),
+                                      idist.data());
+                
+                for (idx jj = 0; jj < k; ++jj) {
+                    vnbr(ii, jj) = jj < m ? inbr[jj] : -1;
+                    vdist(ii, jj) = jj < m ? idist[jj]
+                                   : std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+
+/* All PSs within radius [m] of the stations. The neighbours of the ii-th
+ * station are nbr[first[ii]] ... nbr[first[ii + 1] - 1]. If nbr is None
+ * only first is filled so the output arrays can be allocated. */
+int kdtree_radius(void const* tree, arr_in coords, double const radius,
+                  arr_out first, aux::Array* nbr, aux::Array* dist)
+{
+    try {
+        auto const& kd = *static_cast<spatial::KDTree const*>(tree);
+        auto const sta = spatial::to_points(coords);
+        auto vfirst = first.view<int64_t>(1);
+        auto const ns = idx(sta.size());
+        
+        if (vfirst.shape(0) != ns + 1) {
+            throw std::runtime_error("first should have (number of stations "
+                                     "+ 1) elements!");
+        }
+        
+        std::vector<std::vector<idx>> inbr(ns);
+        std::vector<std::vector<double>> idist(ns);
+        
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (idx ii = 0; ii < ns; ++ii) {
+            kd.radius(sta[ii], radius, inbr[ii], idist[ii]);
+        }
+        
+        vfirst(0) = 0;
+        for (idx ii = 0; ii < ns; ++ii) {
+            vfirst(ii + 1) = vfirst(ii) + idx(inbr[ii].size());
+        }
+        
+        if (nbr == nullptr or dist == nullptr) {
+            return 0;
+        }
+        
+        auto vnbr = nbr->view<int64_t>(1);
+        auto vdist = dist->view<double>(1);
+        
+        if (vnbr.shape(0) < vfirst(ns) or vdist.shape(0) < vfirst(ns)) {
+            throw std::runtime_error("nbr and dist are too small!");
+        }
+        
+        for (idx ii = 0; ii < ns; ++ii) {
+            for (idx jj = 0; jj < idx(inbr[ii].size()); ++jj) {
+                vnbr(vfirst(ii) + jj) = inbr[ii][jj];
+                vdist(vfirst(ii) + jj) = idist[ii][jj];
+            }
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+
+/* Inverse distance weighted interpolation of the columns of values
+ * (number of PSs x ncol) to the points of coords, see spatial::IDW for
+ * k, radius and power. out has shape (number of points, ncol), count
+ * is the number of PSs used per point. */
+int kdtree_interpolate(void const* tree, arr_in coords, arr_in values,
+                       idx const k, double const radius, double const power,
+                       arr_out out, arr_out count)
+{
+    try {
+        auto const& kd = *static_cast<spatial::KDTree const*>(tree);
+        auto const targets = spatial::to_points(coords);
+        auto const vval = values.const_view<double>(2);
+        auto vout = out.view<double>(2);
+        auto vcount = count.view<int64_t>(1);
+        auto const nt = idx(targets.size()), ncol = vval.shape(1);
+        
+        if (vval.shape(0) != kd.size()) {
+            throw std::runtime_error("values should have one row per PS!");
+        }
+        
+        if (vout.shape(0) != nt or vout.shape(1) != ncol or
+            vcount.shape(0) != nt) {
+            throw std::runtime_error("out should have shape (number of "
+                                     "points, number of columns), count "
+                                     "one element per point!");
+        }
+        
+        std::vector<double> val(kd.size() * ncol), res(nt * ncol);
+        std::vector<idx> cnt(nt);
+        
+        for (idx ii = 0; ii < kd.size(); ++ii) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                val[ii * ncol + cc] = vval(ii, cc);
+            }
+        }
+        
+        spatial::interpolate(kd, spatial::IDW(k, radius, power), val.data(),
+                             ncol, targets, res.data(), cnt.data());
+        
+        for (idx ii = 0; ii < nt; ++ii) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                vout(ii, cc) = res[ii * ncol + cc];
+            }
+            vcount(ii) = cnt[ii];
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+/* Ordinary kriging of the columns of values (one row per PS) to the
+ * points in coords from their k nearest PSs, model: 0 spherical,
+ * 1 exponential, 2 gaussian. */
+int kdtree_krige(void const* tree, arr_in coords, arr_in values, idx const k,
+                 double const radius, int const model, double const nugget,
+                 double const sill, double const range, arr_out out,
+                 arr_out var, arr_out count)
+{
+    try {
+        auto const& kd = *static_cast<spatial::KDTree const*>(tree);
+        auto const targets = spatial::to_points(coords);
+        auto const vval = values.const_view<double>(2);
+        auto vout = out.view<double>(2);
+        auto vvar = var.view<double>(1);
+        auto vcount = count.view<int64_t>(1);
+        auto const nt = idx(targets.size()), ncol = vval.shape(1);
+        
+        if (model < 0 or model > 2) {
+            throw std::runtime_error("model should be 0 (spherical), "
+                                     "1 (exponential) or 2 (gaussian)!");
+        }
+        
+        if (vval.shape(0) != kd.size()) {
+            throw std::runtime_error("values should have one row per PS!");
+        }
+        
+        if (vout.shape(0) != nt or vout.shape(1) != ncol or
+            vvar.shape(0) != nt or vcount.shape(0) != nt) {
+            throw std::runtime_error("out should have shape (number of "
+                                     "points, number of columns), var and "
+                                     "count one element per point!");
+        }
+        
+        std::vector<double> val(kd.size() * ncol), res(nt * ncol), sig(nt);
+        std::vector<idx> cnt(nt);
+        
+        for (idx ii = 0; ii < kd.size(); ++ii) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                val[ii * ncol + cc] = vval(ii, cc);
+            }
+        }
+        
+        spatial::Variogram const vgm(static_cast<spatial::Model>(model),
+                                     nugget, sill, range);
+        
+        spatial::krige(kd, spatial::Kriging(k, radius, vgm), val.data(), ncol,
+                       targets, res.data(), sig.data(), cnt.data());
+        
+        for (idx ii = 0; ii < nt; ++ii) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                vout(ii, cc) = res[ii * ncol + cc];
+            }
+            vvar(ii) = sig[ii];
+            vcount(ii) = cnt[ii];
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+/* Empirical semivariogram of values (one per PS) up to max_lag [m] in
+ * nbins bins, lag, gamma and count have nbins elements. */
+int kdtree_variogram(void const* tree, arr_in values, double const max_lag,
+                     double const fraction, idx const seed, arr_out lag,
+                     arr_out gamma, arr_out count)
+{
+    try {
+        auto const& kd = *static_cast<spatial::KDTree const*>(tree);
+        auto const vval = values.const_view<double>(1);
+        auto vlag = lag.view<double>(1), vgamma = gamma.view<double>(1);
+        auto vcount = count.view<int64_t>(1);
+        auto const nbins = vlag.shape(0);
+        
+        if (vval.shape(0) != kd.size()) {
+            throw std::runtime_error("values should have one element per PS!");
+        }
+        
+        if (vgamma.shape(0) != nbins or vcount.shape(0) != nbins) {
+            throw std::runtime_error("lag, gamma and count should have the "
+                                     "same number of elements!");
+        }
+        
+        std::vector<double> val(kd.size()), rlag(nbins), rgamma(nbins);
+        std::vector<idx> cnt(nbins);
+        
+        for (idx ii = 0; ii < kd.size(); ++ii) {
+            val[ii] = vval(ii);
+        }
+        
+        spatial::variogram(kd, val.data(), max_lag, nbins, fraction, seed,
+                           rlag.data(), rgamma.data(), cnt.data());
+        
+        for (idx ii = 0; ii < nbins; ++ii) {
+            vlag(ii) = rlag[ii];
+            vgamma(ii) = rgamma[ii];
+            vcount(ii) = cnt[ii];
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+/* Gridding of PS values v at (x, y) into the cells of a regular grid,
+ * (x0, y0) is the upper left corner, which is a combination of
+ * raster::stats. The bands are written to path (and path.hdr) if it is
+ * not NULL and copied into out (bands, ny, nx) if it is not NULL. */
+int grid_ps(arr_in x, arr_in y, arr_in v, double const x0, double const y0,
+            double const dx, double const dy, idx const nx, idx const ny,
+            int const which, char const* path, char const* projection,
+            char const* extra, aux::Array* out)
+{
+    try {
+        auto const vx = x.const_view<double>(1), vy = y.const_view<double>(1),
+                   vv = v.const_view<double>(1);
+        auto const n = vx.shape(0);
+        
+        if (vy.shape(0) != n or vv.shape(0) != n) {
+            throw std::runtime_error("x, y and v should have the same "
+                                     "number of elements!");
+        }
+        
+        std::vector<double> px(n), py(n), pv(n);
+        
+        for (idx ii = 0; ii < n; ++ii) {
+            px[ii] = vx(ii);
+            py[ii] = vy(ii);
+            pv[ii] = vv(ii);
+        }
+        
+        auto const gridded = raster::bin(raster::Grid(x0, y0, dx, dy, nx, ny),
+                                         px.data(), py.data(), pv.data(), n,
+                                         which);
+        
+        if (path != nullptr) {
+            raster::write_envi(path, gridded,
+                               projection != nullptr ? projection
+                                                     : "Geographic Lat/Lon",
+                               extra != nullptr ? extra : "WGS-84");
+        }
+        
+        if (out != nullptr) {
+            auto vout = out->view<float>(3);
+            auto const nb = idx(gridded.bands.size());
+            
+            if (vout.shape(0) != nb or vout.shape(1) != ny or
+                vout.shape(2) != nx) {
+                throw std::runtime_error("out should have shape (number of "
+                                         "bands, ny, nx)!");
+            }
+            
+            for (idx bb = 0; bb < nb; ++bb) {
+                for (idx ii = 0; ii < ny; ++ii) {
+                    for (idx jj = 0; jj < nx; ++jj) {
+                        vout(bb, ii, jj) = gridded.bands[bb][ii * nx + jj];
+                    }
+                }
+            }
+        }
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+/* Level-of-detail index of the points in the first two columns (x, y)
+ * of data. */
+int lod_new(arr_in data, void** lod)
+{
+    try {
+        auto const vd = data.const_view<double>(2);
+        auto const n = vd.shape(0);
+        
+        if (vd.shape(1) < 2) {
+            throw std::runtime_error("data should have x and y columns!");
+        }
+        
+        std::vector<double> xy(2 * n);
+        
+        for (idx ii = 0; ii < n; ++ii) {
+            xy[2 * ii] = vd(ii, 0);
+            xy[2 * ii + 1] = vd(ii, 1);
+        }
+        
+        *lod = new raster::LOD(xy.data(), xy.data() + 1, n, 2);
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+
+int lod_delete(void* lod)
+{
+    delete static_cast<raster::LOD*>(lod);
+    return 0;
+}
+
+
+/* Bounds of the indexed points as xmin, xmax, ymin and ymax. */
+int lod_extent(void const* lod, double* extent)
+{
+    auto const& index = *static_cast<raster::LOD const*>(lod);
+    
+    extent[0] = index.x0;
+    extent[1] = index.x1;
+    extent[2] = index.y0;
+    extent[3] = index.y1;
+    
+    return 0;
+}
+
+
+/* At most one row of data per pixel of the nx x ny raster covering the
+ * extent, written to path in GMT native binary format. reduce: 0 keeps a
+ * representative point, 1 averages the points of the pixel. */
+int lod_select(void const* lod, arr_in data, double const xmin,
+               double const xmax, double const ymin, double const ymax,
+               idx const nx, idx const ny, int const reduce,
+               char const* path, idx* nout)
+{
+    try {
+        auto const& index = *static_cast<raster::LOD const*>(lod);
+        auto const vd = data.const_view<double>(2);
+        auto const n = vd.shape(0), ncol = vd.shape(1);
+        
+        if (n != index.size()) {
+            throw std::runtime_error("data should be the one the index was "
+                                     "built from!");
+        }
+        
+        if (reduce < 0 or reduce > 1) {
+            throw std::runtime_error("reduce should be 0 (representative) "
+                                     "or 1 (mean)!");
+        }
+        
+        std::vector<double> rows(n * ncol), out;
+        
+        for (idx ii = 0; ii < n; ++ii) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                rows[ii * ncol + cc] = vd(ii, cc);
+            }
+        }
+        
+        *nout = index.select(rows.data(), ncol, xmin, xmax, ymin, ymax, nx,
+                             ny, static_cast<raster::Reduce>(reduce), out);
+        
+        raster::write_gmt(path, out);
+        
+        return 0;
+    }
+    catch(exception& e) {
+        cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
 /*
 int eval_poly(math::poly_in poly, arr_in x, arr_out y)
 {
@@ -55,20 +55,26 @@ def main():
 
     flags = set(get_config_var('CFLAGS').split())
     flags.remove("-Wstrict-prototypes")
-    flags |= {"-std=c++11", "-Wall", "-Wextra"}
+    flags |= {"-std=c++11", "-Wall", "-Wextra", "-fopenmp", "-march=native"}
     flags = list(flags)
     
     macros = []
-    inc_dirs = ["aux", "inmet"]
+    inc_dirs = ["aux", "inmet", "satorbit", "spatial", "raster",
+                "ThirdParty"]
     # lib_dirs = [mjoin("lib")]
     libs = ["stdc++"]
     
     
     modules = [
         CTypes("inmet_aux",
-               sources=["inmet.cpp"], 
+               sources=["inmet.cpp", "satorbit/satorbit.cpp",
+                        "satorbit/orbit.cpp", "satorbit/metafile.cpp",
+                        "satorbit/catalog.cpp", "spatial/spatial.cpp",
+                        "spatial/kriging.cpp", "raster/raster.cpp",
+                        "raster/lod.cpp"], 
                include_dirs=inc_dirs,
                extra_compile_args=flags,
+               extra_link_args=["-fopenmp"],
                language="c++"
         )
     ]
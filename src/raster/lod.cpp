@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+#include "lod.hpp"
+
+
+namespace raster {
+
+
+// spreads the lower 31 bits of v to the even bits
+static uint64_t spread(uint64_t v)
+{
+    v &= 0x7fffffffULL;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v <<  8)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v <<  4)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v <<  2)) & 0x3333333333333333ULL;
+    v = (v | (v <<  1)) & 0x5555555555555555ULL;
+    
+    return v;
+}
+
+
+// inverse of spread
+static uint64_t compact(uint64_t v)
+{
+    v &= 0x5555555555555555ULL;
+    v = (v | (v >>  1)) & 0x3333333333333333ULL;
+    v = (v | (v >>  2)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v >>  4)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v >>  8)) & 0x0000ffff0000ffffULL;
+    v = (v | (v >> 16)) & 0x00000000ffffffffULL;
+    
+    return v;
+}
+
+
+LOD::LOD(double const* x, double const* y, idx const n, idx const stride)
+: code(n), order(n)
+{
+    if (n == 0) {
+        return;
+    }
+    
+    auto xmin = x[0], xmax = x[0], ymin = y[0], ymax = y[0];
+    
+    for (idx ii = 1; ii < n; ++ii) {
+        xmin = std::min(xmin, x[ii * stride]);
+        xmax = std::max(xmax, x[ii * stride]);
+        ymin = std::min(ymin, y[ii * stride]);
+        ymax = std::max(ymax, y[ii * stride]);
+    }
+    
+    x0 = xmin;
+    y0 = ymin;
+    x1 = xmax;
+    y1 = ymax;
+    side = std::max(xmax - xmin, ymax - ymin);
+    side = side > 0.0 ? side * (1.0 + 1e-9) : 1.0;
+    
+    double const scale = double(1ULL << levels) / side,
+                 maxq = double((1ULL << levels) - 1);
+    
+    std::vector<std::pair<uint64_t, idx>> keyed(n);
+    
+    for (idx ii = 0; ii < n; ++ii) {
+        auto const qx = (x[ii * stride] - x0) * scale,
+                   qy = (y[ii * stride] - y0) * scale;
+        auto const ix = uint64_t(std::min(maxq, std::max(0.0, qx))),
+                   iy = uint64_t(std::min(maxq, std::max(0.0, qy)));
+        
+        keyed[ii] = {spread(ix) | (spread(iy) << 1), ii};
+    }
+    
+    std::sort(keyed.begin(), keyed.end());
+    
+    for (idx ii = 0; ii < n; ++ii) {
+        code[ii] = keyed[ii].first;
+        order[ii] = keyed[ii].second;
+    }
+}
+
+
+void LOD::cells(idx const lo, idx const hi, int const level, uint64_t const cd,
+                int const stop, double const* ext,
+                std::vector<range_t>& found) const
+{
+    auto const cs = side / double(1ULL << level);
+    auto const cx = x0 + double(compact(cd)) * cs,
+               cy = y0 + double(compact(cd >> 1)) * cs;
+    
+    // outside of the extent
+    if (cx > ext[1] or cx + cs < ext[0] or cy > ext[3] or cy + cs < ext[2]) {
+        return;
+    }
+    
+    if (hi - lo == 1 or level >= stop) {
+        found.emplace_back(lo, hi);
+        return;
+    }
+    
+    auto const shift = 2 * (levels - level - 1);
+    auto start = lo;
+    
+    for (uint64_t cc = 0; cc < 4; ++cc) {
+        auto const child = cd * 4 + cc;
+        auto const end = cc == 3 ? hi
+                       : idx(std::lower_bound(code.begin() + start,
+                                              code.begin() + hi,
+                                              (child + 1) << shift)
+                             - code.begin());
+        
+        if (end > start) {
+            cells(start, end, level + 1, child, stop, ext, found);
+        }
+        start = end;
+    }
+}
+
+
+idx LOD::select(double const* data, idx const ncol, double const xmin,
+                double const xmax, double const ymin, double const ymax,
+                idx const nx, idx const ny, Reduce const reduce,
+                std::vector<double>& out) const
+{
+    if (not (xmax > xmin and ymax > ymin) or nx <= 0 or ny <= 0) {
+        throw std::runtime_error("Invalid extent or raster size!");
+    }
+    
+    if (ncol < 2) {
+        throw std::runtime_error("data should have x and y columns!");
+    }
+    
+    out.clear();
+    
+    if (size() == 0) {
+        return 0;
+    }
+    
+    double const ext[] = {xmin, xmax, ymin, ymax},
+                 dx = (xmax - xmin) / nx, dy = (ymax - ymin) / ny;
+    
+    // coarsest level with cells not larger than a pixel
+    int stop = 0;
+    
+    while (stop < levels and side / double(1ULL << stop) > std::min(dx, dy)) {
+        stop++;
+    }
+    
+    // cells are not split below a pixel (half a pixel for representative
+    // points, so few pixels are left without one), the number of visited
+    // cells depends on the raster and not on the number of points
+    auto const depth = reduce == Reduce::representative
+                       ? std::min(levels, stop + 1) : stop;
+    
+    std::vector<range_t> found;
+    cells(0, size(), 0, 0, depth, ext, found);
+    
+    auto pixel = [&](idx const ii) -> idx {
+        auto const x = data[ii * ncol], y = data[ii * ncol + 1];
+        
+        if (x < xmin or x > xmax or y < ymin or y > ymax) {
+            return -1;
+        }
+        
+        auto const px = std::min(nx - 1, idx((x - xmin) / dx)),
+                   py = std::min(ny - 1, idx((ymax - y) / dy));
+        
+        return py * nx + px;
+    };
+    
+    // accumulators of the occupied pixels in order of first appearance
+    std::vector<idx> slot(nx * ny, -1);
+    idx nacc = 0;
+    
+    if (reduce == Reduce::representative) {
+        // a cell straddling a pixel border counts for the pixel of its
+        // middle point
+        std::vector<std::pair<idx, idx>> best;  // (number of points, point)
+        
+        for (auto const& r : found) {
+            auto ii = order[r.first + (r.second - r.first) / 2];
+            auto pix = pixel(ii);
+            
+            // cell on the border of the extent
+            for (auto jj = r.first; pix == -1 and jj < r.second; ++jj) {
+                pix = pixel(ii = order[jj]);
+            }
+            
+            if (pix == -1) {
+                continue;
+            }
+            
+            auto const m = r.second - r.first;
+            
+            if (slot[pix] == -1) {
+                slot[pix] = nacc++;
+                best.emplace_back(m, ii);
+            } else if (best[slot[pix]].first < m) {
+                best[slot[pix]] = {m, ii};
+            }
+        }
+        
+        out.resize(nacc * ncol);
+        
+        for (idx kk = 0; kk < nacc; ++kk) {
+            std::copy(data + best[kk].second * ncol,
+                      data + (best[kk].second + 1) * ncol,
+                      out.begin() + kk * ncol);
+        }
+    } else {
+        std::vector<idx> count;
+        
+        for (auto const& r : found) {
+            for (auto jj = r.first; jj < r.second; ++jj) {
+                auto const ii = order[jj];
+                auto const pix = pixel(ii);
+                
+                if (pix == -1) {
+                    continue;
+                }
+                
+                if (slot[pix] == -1) {
+                    slot[pix] = nacc++;
+                    count.push_back(0);
+                    out.resize(nacc * ncol, 0.0);
+                }
+                
+                auto const kk = slot[pix];
+                auto const row = data + ii * ncol;
+                
+                count[kk]++;
+                
+                for (idx cc = 0; cc < ncol; ++cc) {
+                    out[kk * ncol + cc] += row[cc];
+                }
+            }
+        }
+        
+        for (idx kk = 0; kk < nacc; ++kk) {
+            for (idx cc = 0; cc < ncol; ++cc) {
+                out[kk * ncol + cc] /= count[kk];
+            }
+        }
+    }
+    
+    return nacc;
+}
+
+
+void write_gmt(std::string const& path, std::vector<double> const& rows)
+{
+    FILE* out = fopen(path.c_str(), "wb");
+    
+    if (out == nullptr) {
+        throw std::runtime_error("Could not open " + path + " for writing!");
+    }
+    
+    if (fwrite(rows.data(), sizeof(double), rows.size(), out) != rows.size()) {
+        fclose(out);
+        throw std::runtime_error("Could not write " + path + "!");
+    }
+    
+    fclose(out);
+}
+
+// namespace end
+}
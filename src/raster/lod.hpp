@@ -0,0 +1,90 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __LOD_HPP
+#define __LOD_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "aux.hpp"
+
+
+namespace raster {
+
+using aux::idx;
+
+
+/* Ways of reducing the points falling into one output pixel. */
+enum class Reduce : int {
+    // the middle point of the most populated quadtree cell of half a pixel
+    // in the pixel
+    representative = 0,
+    // mean of the coordinates and values of all points of the pixel
+    mean = 1
+};
+
+
+/* Level-of-detail index of scattered points: an implicit quadtree given
+ * by the points sorted along a Morton (Z-order) curve. Cells of every
+ * level are contiguous ranges of the sorted points, so selecting at a
+ * coarse level visits a number of cells proportional to the number of
+ * output pixels, not to the number of points. */
+struct LOD {
+    static constexpr int levels = 31;
+    
+    double x0 = 0.0, y0 = 0.0, side = 1.0;  // square covering the points
+    double x1 = 0.0, y1 = 0.0;              // largest x and y of the points
+    std::vector<uint64_t> code;             // sorted Morton codes
+    std::vector<idx> order;                 // point indices in code order
+    
+    LOD() = default;
+    ~LOD() = default;
+    
+    LOD(double const* x, double const* y, idx const n, idx const stride = 1);
+    
+    idx size() const { return idx(order.size()); }
+    
+    /* At most one point per pixel of the nx x ny raster covering
+     * [xmin, xmax] x [ymin, ymax]. data holds ncol columns (row-major,
+     * x and y are the first two) of the points the index was built from,
+     * out receives the selected rows. Returns the number of rows. */
+    idx select(double const* data, idx const ncol, double const xmin,
+               double const xmax, double const ymin, double const ymax,
+               idx const nx, idx const ny, Reduce const reduce,
+               std::vector<double>& out) const;
+    
+private:
+    using range_t = std::pair<idx, idx>;
+    
+    void cells(idx const lo, idx const hi, int const level, uint64_t const cd,
+               int const stop, double const* ext,
+               std::vector<range_t>& found) const;
+};
+
+
+/* Writes rows of ncol doubles, the GMT native binary layout
+ * (-bi<ncol>d). */
+void write_gmt(std::string const& path, std::vector<double> const& rows);
+
+// namespace end
+}
+
+// guard
+#endif
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "raster.hpp"
+
+
+namespace raster {
+
+
+// partial grids of all threads together are not larger than this
+static constexpr size_t max_partial_bytes = size_t(512) << 20;
+
+
+idx Grid::cell(double const x, double const y) const
+{
+    auto const col = floor((x - x0) / dx), row = floor((y0 - y) / dy);
+    
+    if (not (col >= 0.0 and col < nx and row >= 0.0 and row < ny)) {
+        return -1;
+    }
+    
+    return idx(row) * nx + idx(col);
+}
+
+
+struct Partial {
+    std::vector<int32_t> n;
+    std::vector<double> mean, m2;
+    
+    explicit Partial(idx const size) : n(size, 0), mean(size, 0.0),
+                                       m2(size, 0.0) {}
+};
+
+
+Gridded bin(Grid const& grid, double const* x, double const* y,
+            double const* v, idx const n, int const which)
+{
+    if (grid.nx <= 0 or grid.ny <= 0 or grid.dx <= 0.0 or grid.dy <= 0.0) {
+        throw std::runtime_error("Grid should have positive size and "
+                                 "spacing!");
+    }
+    
+    auto const ncell = grid.size();
+    auto const nan = std::numeric_limits<float>::quiet_NaN();
+    
+    int nthread = 1;
+    
+    #ifdef _OPENMP
+    nthread = omp_get_max_threads();
+    #endif
+    
+    auto const cell_bytes = sizeof(int32_t) + 2 * sizeof(double);
+    nthread = int(std::max(size_t(1),
+                           std::min(size_t(nthread),
+                                    max_partial_bytes / (ncell * cell_bytes))));
+    
+    std::vector<Partial> part(nthread, Partial(0));
+    std::vector<idx> cells(n);
+    
+    #pragma omp parallel num_threads(nthread)
+    {
+        int tid = 0;
+        
+        #ifdef _OPENMP
+        tid = omp_get_thread_num();
+        #endif
+        
+        part[tid] = Partial(ncell);
+        auto& p = part[tid];
+        
+        #pragma omp for schedule(static)
+        for (idx ii = 0; ii < n; ++ii) {
+            auto const cc = cells[ii] = grid.cell(x[ii], y[ii]);
+            
+            if (cc < 0 or std::isnan(v[ii])) {
+                cells[ii] = -1;
+                continue;
+            }
+            
+            auto const delta = v[ii] - p.mean[cc];
+            p.n[cc]++;
+            p.mean[cc] += delta / p.n[cc];
+            p.m2[cc] += delta * (v[ii] - p.mean[cc]);
+        }
+    }
+    
+    // merge of partial grids (Chan et al.)
+    auto& tot = part[0];
+    
+    for (int tt = 1; tt < nthread; ++tt) {
+        auto const& p = part[tt];
+        
+        // the runtime may have started less threads
+        if (p.n.empty()) {
+            continue;
+        }
+        
+        #pragma omp parallel for schedule(static)
+        for (idx cc = 0; cc < ncell; ++cc) {
+            if (p.n[cc] == 0) {
+                continue;
+            }
+            
+            auto const na = double(tot.n[cc]), nb = double(p.n[cc]),
+                       delta = p.mean[cc] - tot.mean[cc];
+            
+            tot.mean[cc] += delta * nb / (na + nb);
+            tot.m2[cc] += p.m2[cc] + delta * delta * na * nb / (na + nb);
+            tot.n[cc] += p.n[cc];
+        }
+        
+        part[tt] = Partial(0);
+    }
+    
+    Gridded ret;
+    ret.grid = grid;
+    
+    if (which & Count) {
+        ret.names.push_back("count");
+        ret.bands.emplace_back(tot.n.begin(), tot.n.end());
+    }
+    
+    if (which & Mean) {
+        ret.names.push_back("mean");
+        ret.bands.emplace_back(ncell);
+        auto& band = ret.bands.back();
+        
+        for (idx cc = 0; cc < ncell; ++cc) {
+            band[cc] = tot.n[cc] > 0 ? float(tot.mean[cc]) : nan;
+        }
+    }
+    
+    if (which & Median) {
+        // values sorted into cells with counting sort
+        std::vector<idx> first(ncell + 1, 0);
+        
+        for (idx cc = 0; cc < ncell; ++cc) {
+            first[cc + 1] = first[cc] + tot.n[cc];
+        }
+        
+        std::vector<double> vals(first[ncell]);
+        std::vector<idx> pos(first.begin(), first.end() - 1);
+        
+        for (idx ii = 0; ii < n; ++ii) {
+            if (cells[ii] >= 0) {
+                vals[pos[cells[ii]]++] = v[ii];
+            }
+        }
+        
+        ret.names.push_back("median");
+        ret.bands.emplace_back(ncell, nan);
+        auto& band = ret.bands.back();
+        
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (idx cc = 0; cc < ncell; ++cc) {
+            auto const m = first[cc + 1] - first[cc];
+            
+            if (m == 0) {
+                continue;
+            }
+            
+            auto const beg = vals.begin() + first[cc], end = beg + m,
+                       mid = beg + m / 2;
+            
+            std::nth_element(beg, mid, end);
+            
+            if (m % 2 == 1) {
+                band[cc] = float(*mid);
+            } else {
+                band[cc] = float(0.5 * (*mid + *std::max_element(beg, mid)));
+            }
+        }
+    }
+    
+    if (which & Std) {
+        ret.names.push_back("std");
+        ret.bands.emplace_back(ncell);
+        auto& band = ret.bands.back();
+        
+        for (idx cc = 0; cc < ncell; ++cc) {
+            band[cc] = tot.n[cc] > 1 ? float(sqrt(tot.m2[cc] / (tot.n[cc] - 1)))
+                                     : nan;
+        }
+    }
+    
+    return ret;
+}
+
+
+void write_envi(std::string const& path, Gridded const& gridded,
+                std::string const& projection, std::string const& extra)
+{
+    auto const& grid = gridded.grid;
+    
+    FILE* out = fopen(path.c_str(), "wb");
+    
+    if (out == nullptr) {
+        throw std::runtime_error("Could not open " + path + " for writing!");
+    }
+    
+    for (auto const& band : gridded.bands) {
+        if (fwrite(band.data(), sizeof(float), band.size(), out)
+            != band.size()) {
+            fclose(out);
+            throw std::runtime_error("Could not write " + path + "!");
+        }
+    }
+    fclose(out);
+    
+    auto const hdr = path + ".hdr";
+    
+    if ((out = fopen(hdr.c_str(), "wt")) == nullptr) {
+        throw std::runtime_error("Could not open " + hdr + " for writing!");
+    }
+    
+    int const one = 1;
+    
+    fprintf(out, "ENVI\ndescription = {inmet PS gridding}\n");
+    fprintf(out, "samples = %ld\nlines = %ld\nbands = %ld\n",
+            long(grid.nx), long(grid.ny), long(gridded.bands.size()));
+    fprintf(out, "header offset = 0\nfile type = ENVI Standard\n");
+    fprintf(out, "data type = 4\ninterleave = bsq\nbyte order = %d\n",
+            *reinterpret_cast<char const*>(&one) == 1 ? 0 : 1);
+    fprintf(out, "map info = {%s, 1, 1, %.10f, %.10f, %.10e, %.10e%s%s}\n",
+            projection.c_str(), grid.x0, grid.y0, grid.dx, grid.dy,
+            extra.empty() ? "" : ", ", extra.c_str());
+    
+    fprintf(out, "band names = {");
+    for (size_t ii = 0; ii < gridded.names.size(); ++ii) {
+        fprintf(out, "%s%s", ii > 0 ? ", " : "", gridded.names[ii].c_str());
+    }
+    fprintf(out, "}\ndata ignore value = NaN\n");
+    
+    fclose(out);
+}
+
+// namespace end
+}
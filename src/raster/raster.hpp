@@ -0,0 +1,89 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RASTER_HPP
+#define __RASTER_HPP
+
+
+#include <string>
+#include <vector>
+
+#include "aux.hpp"
+
+
+namespace raster {
+
+using aux::idx;
+
+
+/* Regular grid of lon/lat or projected coordinates. (x0, y0) is the
+ * upper left corner of the upper left cell, rows run from north to
+ * south. */
+struct Grid {
+    double x0 = 0.0, y0 = 0.0, dx = 1.0, dy = 1.0;
+    idx nx = 0, ny = 0;
+    
+    Grid() = default;
+    ~Grid() = default;
+    
+    Grid(double const x0, double const y0, double const dx, double const dy,
+         idx const nx, idx const ny)
+    : x0(x0), y0(y0), dx(dx), dy(dy), nx(nx), ny(ny) {}
+    
+    idx size() const { return nx * ny; }
+    
+    // index of the cell of (x, y), -1 if it is outside of the grid
+    idx cell(double const x, double const y) const;
+};
+
+
+/* Statistics computed per cell, can be combined with | */
+enum stats {
+    Count = 1, Mean = 2, Median = 4, Std = 8
+};
+
+
+/* Bands of the gridded statistics in the order of the stats enum, cells
+ * without points are NaN (count is 0), std is the sample standard
+ * deviation (NaN for less than 2 points). */
+struct Gridded {
+    Grid grid;
+    std::vector<std::string> names;
+    std::vector<std::vector<float>> bands;
+};
+
+
+/* Bins the points into the cells of grid. Every thread accumulates a
+ * partial grid of count, mean and sum of squared deviations (Welford)
+ * which are merged at the end; medians are selected from the values
+ * sorted into cells. */
+Gridded bin(Grid const& grid, double const* x, double const* y,
+            double const* v, idx const n, int const which);
+
+
+/* Writes the bands as 4 byte floats one after the other (band
+ * sequential) into path and an ENVI header into path.hdr. projection
+ * is the first element of map info (e.g. "Geographic Lat/Lon" or
+ * "UTM"), extra is appended to it (e.g. "WGS-84" or "34, North,
+ * WGS-84"). */
+void write_envi(std::string const& path, Gridded const& gridded,
+                std::string const& projection, std::string const& extra);
+
+// namespace end
+}
+
+// guard
+#endif
@@ -0,0 +1,98 @@
+/* Regression checks of the PS gridding on a small grid with empty cells,
+ * with one and with several threads. Prints ok or FAILED for every
+ * check, the exit status is the number of failed checks. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "raster.hpp"
+
+
+static int failed = 0;
+
+
+static void report(std::string const& what, bool const ok)
+{
+    std::printf("%-60s %s\n", what.c_str(), ok ? "ok" : "FAILED");
+    
+    if (not ok) {
+        failed++;
+    }
+}
+
+
+static bool same_value(float const a, double const b)
+{
+    return std::abs(a - b) <= 1e-6 * std::max(1.0, std::abs(b));
+}
+
+
+/* 3 x 2 grid of unit cells with the upper left corner at (0, 2). Upper
+ * row: 1, 2 and 4; a single 5; 1 and 3. Lower row: nothing, a NaN value
+ * only and nothing; plus a point outside of the grid. */
+static void check_bin(int const threads)
+{
+    #ifdef _OPENMP
+    omp_set_num_threads(threads);
+    #endif
+    
+    raster::Grid const grid(0.0, 2.0, 1.0, 1.0, 3, 2);
+    
+    std::vector<double> const
+        x = {0.5, 0.2, 0.8, 1.5, 2.5, 2.5, 1.5, 3.5},
+        y = {1.5, 1.2, 1.8, 1.5, 1.5, 1.5, 0.5, 0.5},
+        v = {1.0, 2.0, 4.0, 5.0, 1.0, 3.0, NAN, 7.0};
+    
+    auto const g = raster::bin(grid, x.data(), y.data(), v.data(),
+                               raster::idx(x.size()),
+                               raster::Count | raster::Mean | raster::Median
+                               | raster::Std);
+    
+    auto const name = std::to_string(threads) + " threads: ";
+    
+    report(name + "band names",
+           g.names == std::vector<std::string>{"count", "mean", "median",
+                                               "std"});
+    
+    auto const& count = g.bands[0];
+    auto const& mean = g.bands[1];
+    auto const& median = g.bands[2];
+    auto const& sd = g.bands[3];
+    
+    report(name + "counts", count[0] == 3.0f and count[1] == 1.0f
+                            and count[2] == 2.0f);
+    report(name + "means", same_value(mean[0], 7.0 / 3.0) and mean[1] == 5.0f
+                           and mean[2] == 2.0f);
+    report(name + "medians", median[0] == 2.0f and median[1] == 5.0f
+                             and median[2] == 2.0f);
+    report(name + "sample standard deviations",
+           same_value(sd[0], std::sqrt(7.0 / 3.0)) and std::isnan(sd[1])
+           and same_value(sd[2], std::sqrt(2.0)));
+    
+    bool empty = true;
+    
+    // the NaN value of the middle cell is not counted either
+    for (int cc = 3; cc < 6; ++cc) {
+        empty = empty and count[cc] == 0.0f and std::isnan(mean[cc])
+                and std::isnan(median[cc]) and std::isnan(sd[cc]);
+    }
+    
+    report(name + "empty cells: count 0, NaN statistics", empty);
+}
+
+
+int main()
+{
+    for (int threads : {1, 4}) {
+        check_bin(threads);
+    }
+    
+    return failed;
+}
@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "metafile.h"
+
+
+struct catalog_header {
+    char magic[8];
+    int32_t count, first_day, ndays, reserved;
+    int64_t days, entries;
+    char pad[24];
+};
+
+static_assert(sizeof(catalog_header) == 64,
+              "orbit catalogue header is 64 bytes");
+static_assert(sizeof(orbit_entry) == 64, "orbit entries are 64 bytes");
+
+static char const catalog_magic[] = "INMCAT01";
+
+
+struct orbit_catalog {
+    char const* data;
+    size_t size;
+    catalog_header const* head;
+    orbit_entry const* entries;
+    int32_t const* days;
+};
+
+
+/* Days since 1970-01-01 of a proleptic Gregorian date. */
+static int32_t days_from_civil(int y, int const m, int const d)
+{
+    y -= m <= 2;
+    
+    int const era = (y >= 0 ? y : y - 399) / 400;
+    int const yoe = y - era * 400;
+    int const doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    
+    return era * 146097 + doe - 719468;
+}
+
+
+static bool valid_date(int const y, int const m, int const d)
+{
+    static int const days[] = {31, 28, 31, 30, 31, 30,
+                               31, 31, 30, 31, 30, 31};
+    
+    if (y < 1900 or y >= 2200 or m < 1 or m > 12 or d < 1) {
+        return false;
+    }
+    
+    bool const leap = (y % 4 == 0 and y % 100 != 0) or y % 400 == 0;
+    
+    return d <= days[m - 1] + (m == 2 and leap);
+}
+
+
+static int32_t day_of(int32_t const date)
+{
+    return days_from_civil(date / 10000, (date / 100) % 100, date % 100);
+}
+
+
+/* Acquisition date as yyyymmdd from the first azimuth time of a .res
+ * file, the date of a .par file or eight digits of the path (stacks are
+ * usually organised in date named directories); 0 if none is found. */
+static int32_t acquisition_date(meta_file const* meta, char const* path)
+{
+    static char const months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    
+    char buf[64];
+    size_t len = 0;
+    int y = 0, m = 0, d = 0;
+    
+    auto value = meta_value(meta, nullptr, "First_pixel_azimuth_time",
+                            &len);
+    
+    if (value != nullptr and len < sizeof(buf)) {
+        char mon[4] = "";
+        
+        std::memcpy(buf, value, len);
+        buf[len] = '\0';
+        
+        if (std::sscanf(buf, "%d-%3s-%d", &d, mon, &y) == 3
+            and std::strlen(mon) == 3) {
+            // "JAN" and "jan" as "Jan", it can only match at the start of
+            // a month name then
+            mon[0] = char(std::toupper(static_cast<unsigned char>(mon[0])));
+            mon[1] = char(std::tolower(static_cast<unsigned char>(mon[1])));
+            mon[2] = char(std::tolower(static_cast<unsigned char>(mon[2])));
+            
+            auto const pos = std::strstr(months, mon);
+            m = pos != nullptr ? int(pos - months) / 3 + 1 : 0;
+            
+            if (valid_date(y, m, d)) {
+                return y * 10000 + m * 100 + d;
+            }
+        }
+    }
+    
+    value = meta_value(meta, nullptr, "date", &len);
+    
+    if (value != nullptr and len < sizeof(buf)) {
+        std::memcpy(buf, value, len);
+        buf[len] = '\0';
+        
+        if (std::sscanf(buf, "%d %d %d", &y, &m, &d) == 3
+            and valid_date(y, m, d)) {
+            return y * 10000 + m * 100 + d;
+        }
+    }
+    
+    // last run of exactly eight digits that is a valid date
+    int32_t date = 0;
+    
+    for (auto p = path; *p != '\0'; ++p) {
+        if (not std::isdigit(*p) or (p > path and std::isdigit(p[-1]))) {
+            continue;
+        }
+        
+        int n = 0;
+        
+        while (std::isdigit(p[n])) {
+            ++n;
+        }
+        
+        if (n == 8 and std::sscanf(p, "%4d%2d%2d", &y, &m, &d) == 3
+            and valid_date(y, m, d)) {
+            date = y * 10000 + m * 100 + d;
+        }
+    }
+    
+    return date;
+}
+
+
+struct fitted {
+    orbit_entry entry;
+    std::vector<char> block;
+};
+
+
+/* Reads and fits one input, the orbit goes to out.block as an orbit cache
+ * block. The same fits as daisy poly_orbit. */
+static void fit_file(char const* path, int const kind, int const deg,
+                     double const segment, int const hermite, fitted& out)
+{
+    auto& ee = out.entry;
+    std::memset(&ee, 0, sizeof(ee));
+    
+    auto const meta = meta_open(path);
+    
+    if (meta == nullptr) {
+        ee.status = catalog_unreadable;
+        return;
+    }
+    
+    ee.date = acquisition_date(meta, path);
+    
+    auto const n = meta_state_vectors(meta, nullptr, 0, nullptr);
+    int nvel = 0;
+    std::vector<double> sv(7 * std::max(n, 0));
+    
+    if (n < 1 or meta_state_vectors(meta, sv.data(), n, &nvel) != n) {
+        meta_close(meta);
+        ee.status = catalog_no_orbit;
+        return;
+    }
+    
+    meta_close(meta);
+    ee.nsv = n;
+    
+    if (ee.date == 0) {
+        ee.status = catalog_no_date;
+        return;
+    }
+    
+    // t, x, y, z rows for the fits
+    std::vector<double> txyz(4 * n);
+    
+    for (int ii = 0; ii < n; ++ii) {
+        std::copy(&sv[7 * ii], &sv[7 * ii] + 4, &txyz[4 * ii]);
+    }
+    
+    double const t0 = sv[0], t1 = sv[7 * (n - 1)];
+    orbit_poly orb = {kind, deg + 1, 1, t0, t1, nullptr, nullptr, nullptr};
+    int ret = 1;
+    
+    if (hermite) {
+        orb.kind = orbit_spline; orb.n = 4; orb.nseg = std::max(n - 1, 1);
+    }
+    else if (kind == orbit_spline) {
+        orb.nseg = segment > 0.0 ? int(std::ceil((t1 - t0) / segment))
+                                 : (n - deg - 1) / 2;
+        orb.nseg = std::max(orb.nseg, 1);
+    }
+    
+    std::vector<double> coeffs(3 * orb.n * orb.nseg),
+                        sd(3 * orb.n);
+    orb.coeffs = coeffs.data();
+    
+    if (hermite) {
+        ret = nvel < n ? 1 : orbit_hermite(n, sv.data(), orb.coeffs);
+        ee.dof = 0;
+    }
+    else if (kind == orbit_spline) {
+        ret = orbit_spline_fit(n, deg, orb.nseg, txyz.data(), orb.coeffs,
+                               ee.mu0);
+        ee.dof = n - orb.nseg - deg;
+    }
+    else if (kind == orbit_chebyshev) {
+        ret = orbit_cheb_fit(n, deg, txyz.data(), orb.coeffs, ee.mu0,
+                             sd.data());
+        ee.dof = n - deg - 1;
+    }
+    else {
+        ret = orbit_poly_fit(n, deg, txyz.data(), orb.coeffs, ee.mu0,
+                             sd.data());
+        ee.dof = n - deg - 1;
+    }
+    
+    if (ret != 0) {
+        ee.status = catalog_fit_failed;
+        return;
+    }
+    
+    out.block.resize(orbit_cache_size(&orb));
+    orbit_cache_pack(&orb, ee.mu0, out.block.data());
+}
+
+
+int orbit_catalog_build(char const* path, int const n,
+                        char const* const* inputs, int const kind,
+                        int const deg, double const segment,
+                        int const hermite, orbit_entry* entries)
+{
+    std::vector<fitted> fits(std::max(n, 0));
+    
+    // files are independent, their sizes and fits vary
+    #pragma omp parallel for schedule(dynamic)
+    for (int ii = 0; ii < n; ++ii) {
+        fit_file(inputs[ii], kind, deg, segment, hermite, fits[ii]);
+        fits[ii].entry.input = ii;
+    }
+    
+    // entries sorted by date, the first file of a date wins
+    std::vector<int> order(fits.size());
+    
+    for (size_t ii = 0; ii < order.size(); ++ii) {
+        order[ii] = int(ii);
+    }
+    
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return fits[a].entry.date < fits[b].entry.date;
+    });
+    
+    int32_t first = 0, last = -1;
+    int count = 0, prev = 0;
+    
+    for (auto const ii : order) {
+        auto& ee = fits[ii].entry;
+        
+        if (ee.status != catalog_ok) {
+            continue;
+        }
+        
+        if (count > 0 and ee.date == prev) {
+            ee.status = catalog_duplicate;
+            fits[ii].block.clear();
+            continue;
+        }
+        
+        auto const day = day_of(ee.date);
+        
+        if (count == 0) {
+            first = day;
+        }
+        
+        last = day;
+        prev = ee.date;
+        ++count;
+    }
+    
+    catalog_header head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic, catalog_magic, sizeof(head.magic));
+    
+    head.count = int32_t(order.size());
+    head.first_day = first;
+    head.ndays = last - first + 1;
+    head.entries = sizeof(catalog_header);
+    head.days = head.entries + head.count * int64_t(sizeof(orbit_entry));
+    
+    std::vector<int32_t> days(head.ndays, -1);
+    std::vector<orbit_entry> sorted;
+    
+    // orbit blocks start 8 byte aligned after the day table
+    auto offset = (head.days + head.ndays * int64_t(sizeof(int32_t)) + 7)
+                  / 8 * 8;
+    
+    for (auto const ii : order) {
+        auto& ee = fits[ii].entry;
+        
+        if (ee.status == catalog_ok) {
+            days[day_of(ee.date) - first] = int32_t(sorted.size());
+            ee.offset = offset;
+            offset += fits[ii].block.size();
+        }
+        
+        sorted.push_back(ee);
+    }
+    
+    auto const out = std::fopen(path, "wb");
+    
+    if (out == nullptr) {
+        return -1;
+    }
+    
+    static char const zeros[8] = {0};
+    auto const pad = size_t((8 - (head.days + head.ndays * 4) % 8) % 8);
+    
+    bool ok = std::fwrite(&head, sizeof(head), 1, out) == 1
+              and std::fwrite(sorted.data(), sizeof(orbit_entry),
+                              sorted.size(), out) == sorted.size()
+              and std::fwrite(days.data(), sizeof(int32_t), days.size(), out)
+                  == days.size()
+              and std::fwrite(zeros, 1, pad, out) == pad;
+    
+    for (auto const ii : order) {
+        auto const& block = fits[ii].block;
+        
+        if (ok and fits[ii].entry.status == catalog_ok) {
+            ok = std::fwrite(block.data(), 1, block.size(), out)
+                 == block.size();
+        }
+    }
+    
+    ok = std::fclose(out) == 0 and ok;
+    
+    if (entries != nullptr) {
+        for (size_t ii = 0; ii < fits.size(); ++ii) {
+            entries[ii] = fits[ii].entry;
+        }
+    }
+    
+    return ok ? count : -1;
+}
+
+
+orbit_catalog* orbit_catalog_open(char const* path)
+{
+    auto const fd = open(path, O_RDONLY);
+    
+    if (fd < 0) {
+        return nullptr;
+    }
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) != 0 or size_t(st.st_size) < sizeof(catalog_header)) {
+        close(fd);
+        return nullptr;
+    }
+    
+    auto const size = size_t(st.st_size);
+    auto const map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+    
+    auto const data = static_cast<char const*>(map);
+    auto const head = reinterpret_cast<catalog_header const*>(data);
+    
+    if (std::memcmp(head->magic, catalog_magic, sizeof(head->magic)) != 0
+        or head->count < 0 or head->ndays < 0
+        or size_t(head->days + head->ndays * int64_t(sizeof(int32_t)))
+           > size) {
+        munmap(map, size);
+        return nullptr;
+    }
+    
+    auto cat = new orbit_catalog;
+    
+    cat->data = data;
+    cat->size = size;
+    cat->head = head;
+    cat->entries = reinterpret_cast<orbit_entry const*>(data + head->entries);
+    cat->days = reinterpret_cast<int32_t const*>(data + head->days);
+    
+    return cat;
+}
+
+
+void orbit_catalog_close(orbit_catalog* cat)
+{
+    if (cat != nullptr) {
+        munmap(const_cast<char*>(cat->data), cat->size);
+        delete cat;
+    }
+}
+
+
+int orbit_catalog_size(orbit_catalog const* cat)
+{
+    return cat->head->count;
+}
+
+
+orbit_entry const* orbit_catalog_entry(orbit_catalog const* cat,
+                                       int const ii)
+{
+    return ii >= 0 and ii < cat->head->count ? cat->entries + ii : nullptr;
+}
+
+
+int orbit_catalog_find(orbit_catalog const* cat, int const date,
+                       orbit_poly* orb)
+{
+    auto const y = date / 10000, m = (date / 100) % 100, d = date % 100;
+    
+    if (not valid_date(y, m, d)) {
+        return 1;
+    }
+    
+    auto const day = days_from_civil(y, m, d) - cat->head->first_day;
+    
+    if (day < 0 or day >= cat->head->ndays or cat->days[day] < 0) {
+        return 1;
+    }
+    
+    auto const offset = size_t(cat->entries[cat->days[day]].offset);
+    
+    if (offset >= cat->size
+        or orbit_cache_view(cat->data + offset, cat->size - offset, orb,
+                            nullptr) != 0) {
+        return 1;
+    }
+    
+    return 0;
+}
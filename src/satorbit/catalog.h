@@ -0,0 +1,100 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef __CATALOG_H
+#define __CATALOG_H
+
+/* Orbits of a whole stack fitted in parallel and stored in one file
+ * (.corb), shared by daisy (C) and the satorbit library (C++).
+ * 
+ * Layout: a 64 byte header (the magic "INMCAT01", int32 count, first_day
+ * and ndays, then the int64 offsets of the day table and of the first
+ * entry), count orbit_entry records sorted by date, a table of ndays
+ * int32 entry indices (-1 for days without acquisition) starting at
+ * first_day (days since 1970-01-01) and the orbits as orbit cache blocks
+ * (see orbit.h). An epoch is found with one table lookup. */
+
+#include <stdint.h>
+
+#include "orbit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+enum {
+    catalog_ok = 0,
+    catalog_unreadable = 1, // file cannot be opened
+    catalog_no_orbit = 2,   // no state vectors
+    catalog_no_date = 3,    // acquisition date not found
+    catalog_fit_failed = 4, // not enough state vectors or singular fit
+    catalog_duplicate = 5   // an earlier file has the same date
+};
+
+
+/* Diagnostics of one input file, 64 bytes. */
+typedef struct {
+    int32_t date;    // acquisition date as yyyymmdd, 0 if unknown
+    int32_t status;  // catalog_ok or the reason of the failure
+    int32_t nsv;     // number of state vectors
+    int32_t dof;     // degrees of freedom of the fit
+    double mu0[3];   // standard deviations of unit weight of x, y and z
+    int64_t offset;  // byte offset of the orbit cache block, 0 if none
+    int32_t input;   // index of the input file
+    int32_t reserved[3];
+} orbit_entry;
+
+
+/* Fits the orbits of n .res or .par files in parallel (OpenMP) and writes
+ * the catalogue to path. kind and deg are those of poly_orbit; splines
+ * use segments of about segment seconds (<= 0: about two state vectors
+ * per control point) and hermite != 0 interpolates positions and
+ * velocities instead of fitting. entries (NULLable) receives the
+ * diagnostics in input order. Returns the number of orbits catalogued,
+ * -1 if path cannot be written. */
+int orbit_catalog_build(char const* path, int const n,
+                        char const* const* inputs, int const kind,
+                        int const deg, double const segment,
+                        int const hermite, orbit_entry* entries);
+
+
+typedef struct orbit_catalog orbit_catalog;
+
+
+/* Maps a catalogue, NULL if it cannot be opened or is not a catalogue. */
+orbit_catalog* orbit_catalog_open(char const* path);
+void orbit_catalog_close(orbit_catalog* cat);
+
+int orbit_catalog_size(orbit_catalog const* cat);
+orbit_entry const* orbit_catalog_entry(orbit_catalog const* cat,
+                                       int const ii);
+
+/* Orbit of the acquisition on date (yyyymmdd), orb points into the
+ * mapping and is valid until the catalogue is closed. Returns 0 on
+ * success and 1 if there is no orbit for date. */
+int orbit_catalog_find(orbit_catalog const* cat, int const date,
+                       orbit_poly* orb);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+// guard
+#endif
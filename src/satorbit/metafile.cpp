@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "metafile.h"
+
+
+/* "key: value" line, offsets into the mapping, key and value trimmed. */
+struct entry {
+    size_t key, key_len, value, value_len, next;
+};
+
+
+/* Entries [first, last) belong to the section, keys holds their indices
+ * sorted by key. */
+struct section {
+    size_t name, name_len, first, last;
+    std::vector<size_t> keys;
+};
+
+
+/* keys holds the indices of all entries sorted by key. */
+struct meta_file {
+    char const* data;
+    size_t size;
+    std::vector<entry> entries;
+    std::vector<section> sections;
+    std::vector<size_t> keys;
+};
+
+
+static bool is_space(char const c)
+{
+    return c == ' ' or c == '\t' or c == '\r';
+}
+
+
+static bool starts_with(char const* line, size_t const len,
+                        char const* prefix)
+{
+    auto const n = strlen(prefix);
+    return len >= n and memcmp(line, prefix, n) == 0;
+}
+
+
+/* Name of a section marker "*_Start_name:" / "Start_name", the name ends
+ * at a colon or white space. */
+static size_t marker_name(char const* line, size_t const len,
+                          size_t const skip)
+{
+    size_t ii = skip;
+    
+    while (ii < len and line[ii] != ':' and not is_space(line[ii])) {
+        ++ii;
+    }
+    
+    return ii - skip;
+}
+
+
+/* Key of ee is less than key of length n, bytewise. */
+static bool key_less(meta_file const& meta, entry const& ee, char const* key,
+                     size_t const n)
+{
+    auto const cmp = memcmp(meta.data + ee.key, key, std::min(ee.key_len, n));
+    return cmp < 0 or (cmp == 0 and ee.key_len < n);
+}
+
+
+/* Indices of the entries [first, last) sorted by key, the first line of
+ * equal keys comes first. */
+static std::vector<size_t> sorted_keys(meta_file const& meta,
+                                       size_t const first, size_t const last)
+{
+    std::vector<size_t> keys(last - first);
+    
+    for (size_t ii = first; ii < last; ++ii) {
+        keys[ii - first] = ii;
+    }
+    
+    std::stable_sort(keys.begin(), keys.end(),
+                     [&meta](size_t const a, size_t const b) {
+                         auto const& eb = meta.entries[b];
+                         return key_less(meta, meta.entries[a],
+                                         meta.data + eb.key, eb.key_len);
+                     });
+    
+    return keys;
+}
+
+
+/* One pass over the lines, memchr finds the line ends. The keys are
+ * sorted afterwards, so a lookup is a binary search instead of a scan
+ * of the section. */
+static void build_index(meta_file& meta)
+{
+    auto const data = meta.data, end = data + meta.size;
+    auto line = data;
+    
+    while (line < end) {
+        auto eol = static_cast<char const*>(memchr(line, '\n', end - line));
+        
+        if (eol == nullptr) {
+            eol = end;
+        }
+        
+        size_t const len = eol - line;
+        size_t skip = 0;
+        
+        if (starts_with(line, len, "*_Start_")) {
+            skip = 8;
+        }
+        else if (starts_with(line, len, "Start_")) {
+            skip = 6;
+        }
+        
+        if (skip > 0) {
+            meta.sections.push_back({size_t(line - data) + skip,
+                                     marker_name(line, len, skip),
+                                     meta.entries.size(),
+                                     std::numeric_limits<size_t>::max(),
+                                     {}});
+        }
+        else if (starts_with(line, len, "* End_")
+                 or starts_with(line, len, "End_")) {
+            if (not meta.sections.empty()) {
+                meta.sections.back().last = meta.entries.size();
+            }
+        }
+        else if (auto const colon = static_cast<char const*>(
+                                        memchr(line, ':', len))) {
+            auto kb = line, ke = colon, vb = colon + 1, ve = eol;
+            
+            while (kb < ke and is_space(*kb)) ++kb;
+            while (ke > kb and is_space(ke[-1])) --ke;
+            while (vb < ve and is_space(*vb)) ++vb;
+            while (ve > vb and is_space(ve[-1])) --ve;
+            
+            if (ke > kb) {
+                meta.entries.push_back({size_t(kb - data), size_t(ke - kb),
+                                        size_t(vb - data), size_t(ve - vb),
+                                        size_t(eol - data) + 1});
+            }
+        }
+        
+        line = eol + 1;
+    }
+    
+    // unterminated sections run to the end of the file
+    for (auto& sec : meta.sections) {
+        if (sec.last > meta.entries.size()) {
+            sec.last = meta.entries.size();
+        }
+        
+        sec.keys = sorted_keys(meta, sec.first, sec.last);
+    }
+    
+    meta.keys = sorted_keys(meta, 0, meta.entries.size());
+}
+
+
+meta_file* meta_open(char const* path)
+{
+    auto const fd = open(path, O_RDONLY);
+    
+    if (fd < 0) {
+        return nullptr;
+    }
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) != 0 or st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    
+    auto const size = size_t(st.st_size);
+    auto const map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (map == MAP_FAILED) {
+        return nullptr;
+    }
+    
+    // the whole file is scanned once, right away
+    madvise(map, size, MADV_SEQUENTIAL);
+    
+    auto meta = new meta_file;
+    meta->data = static_cast<char const*>(map);
+    meta->size = size;
+    
+    build_index(*meta);
+    
+    return meta;
+}
+
+
+void meta_close(meta_file* meta)
+{
+    if (meta != nullptr) {
+        munmap(const_cast<char*>(meta->data), meta->size);
+        delete meta;
+    }
+}
+
+
+static entry const* find(meta_file const* meta, char const* sec,
+                         char const* key)
+{
+    auto keys = &meta->keys;
+    
+    if (sec != nullptr) {
+        auto const n = strlen(sec);
+        keys = nullptr;
+        
+        for (auto const& ss : meta->sections) {
+            if (ss.name_len == n
+                and memcmp(meta->data + ss.name, sec, n) == 0) {
+                keys = &ss.keys;
+                break;
+            }
+        }
+        
+        if (keys == nullptr) {
+            return nullptr;
+        }
+    }
+    
+    auto const n = strlen(key);
+    
+    // keys starting with key follow each other in the sorted index
+    auto it = std::lower_bound(keys->begin(), keys->end(), key,
+                               [meta, n](size_t const ii, char const* k) {
+                                   return key_less(*meta, meta->entries[ii],
+                                                   k, n);
+                               });
+    
+    entry const* found = nullptr;
+    
+    for (; it != keys->end(); ++it) {
+        auto const& ee = meta->entries[*it];
+        auto const k = meta->data + ee.key;
+        
+        if (ee.key_len < n or memcmp(k, key, n) != 0) {
+            break;
+        }
+        
+        // exact key or key followed by an annotation, e.g. "(UTC)", the
+        // first line wins
+        if ((ee.key_len == n or k[n] == ' ' or k[n] == '\t' or k[n] == '(')
+            and (found == nullptr or &ee < found)) {
+            found = &ee;
+        }
+    }
+    
+    return found;
+}
+
+
+char const* meta_value(meta_file const* meta, char const* section,
+                       char const* key, size_t* len)
+{
+    auto const ee = find(meta, section, key);
+    
+    if (ee == nullptr) {
+        return nullptr;
+    }
+    
+    if (len != nullptr) {
+        *len = ee->value_len;
+    }
+    
+    return meta->data + ee->value;
+}
+
+
+/* Up to max numbers from text of length len. The text is copied to a
+ * buffer first, the mapping is not zero terminated. */
+static int parse_numbers(char const* text, size_t const len, double* out,
+                         int const max)
+{
+    char buf[512];
+    auto const n = len < sizeof(buf) ? len : sizeof(buf) - 1;
+    
+    memcpy(buf, text, n);
+    buf[n] = '\0';
+    
+    char* pos = buf;
+    int count = 0;
+    
+    while (count < max) {
+        char* next = nullptr;
+        auto const value = strtod(pos, &next);
+        
+        if (next == pos) {
+            break;
+        }
+        
+        out[count++] = value;
+        pos = next;
+    }
+    
+    return count;
+}
+
+
+int meta_double(meta_file const* meta, char const* section,
+                char const* key, double* out)
+{
+    size_t len = 0;
+    auto const value = meta_value(meta, section, key, &len);
+    
+    if (value == nullptr) {
+        return 1;
+    }
+    
+    return parse_numbers(value, len, out, 1) == 1 ? 0 : 2;
+}
+
+
+int meta_int(meta_file const* meta, char const* section, char const* key,
+             int* out)
+{
+    double value = 0.0;
+    auto const ret = meta_double(meta, section, key, &value);
+    
+    if (ret == 0) {
+        *out = int(value);
+    }
+    
+    return ret;
+}
+
+
+/* The n lines following NUMBER_OF_DATAPOINTS in a .res file. */
+static int doris_vectors(meta_file const* meta, entry const& ee, int const n,
+                         double* sv, int const max, int& nvel)
+{
+    auto const end = meta->data + meta->size;
+    auto line = meta->data + ee.next;
+    
+    for (int ii = 0; ii < n and ii < max; ++ii) {
+        if (line >= end) {
+            return -2;
+        }
+        
+        auto eol = static_cast<char const*>(memchr(line, '\n', end - line));
+        
+        if (eol == nullptr) {
+            eol = end;
+        }
+        
+        auto const row = sv + 7 * ii;
+        auto const count = parse_numbers(line, eol - line, row, 7);
+        
+        if (count < 4) {
+            return -2;
+        }
+        
+        if (count == 7) {
+            ++nvel;
+        } else {
+            row[4] = row[5] = row[6] = std::nan("");
+        }
+        
+        line = eol + 1;
+    }
+    
+    return n;
+}
+
+
+/* state_vector_position_i and state_vector_velocity_i lines of a .par
+ * file, times from the first epoch and the interval. */
+static int gamma_vectors(meta_file const* meta, int const n, double* sv,
+                         int const max, int& nvel)
+{
+    double t0 = 0.0, dt = 0.0;
+    
+    if (meta_double(meta, nullptr, "time_of_first_state_vector", &t0) != 0
+        or meta_double(meta, nullptr, "state_vector_interval", &dt) != 0) {
+        return -2;
+    }
+    
+    for (int ii = 0; ii < n and ii < max; ++ii) {
+        auto const row = sv + 7 * ii;
+        auto const idx = std::to_string(ii + 1);
+        size_t len = 0;
+        
+        row[0] = t0 + ii * dt;
+        
+        auto value = meta_value(meta, nullptr,
+                                ("state_vector_position_" + idx).c_str(),
+                                &len);
+        
+        if (value == nullptr or parse_numbers(value, len, row + 1, 3) != 3) {
+            return -2;
+        }
+        
+        value = meta_value(meta, nullptr,
+                           ("state_vector_velocity_" + idx).c_str(), &len);
+        
+        if (value != nullptr and parse_numbers(value, len, row + 4, 3) == 3) {
+            ++nvel;
+        } else {
+            row[4] = row[5] = row[6] = std::nan("");
+        }
+    }
+    
+    return n;
+}
+
+
+int meta_state_vectors(meta_file const* meta, double* sv, int const max,
+                       int* nvel)
+{
+    int n = 0, vel = 0, ret = -1;
+    
+    auto ee = find(meta, "precise_orbits", "NUMBER_OF_DATAPOINTS");
+    
+    if (ee == nullptr) {
+        ee = find(meta, nullptr, "NUMBER_OF_DATAPOINTS");
+    }
+    
+    if (ee != nullptr) {
+        double count = 0.0;
+        
+        if (parse_numbers(meta->data + ee->value, ee->value_len, &count, 1)
+            != 1 or count < 1.0) {
+            return -1;
+        }
+        
+        n = int(count);
+        
+        ret = sv == nullptr ? n : doris_vectors(meta, *ee, n, sv, max, vel);
+    }
+    else if (meta_int(meta, nullptr, "number_of_state_vectors", &n) == 0
+             and n > 0) {
+        ret = sv == nullptr ? n : gamma_vectors(meta, n, sv, max, vel);
+    }
+    
+    if (nvel != nullptr) {
+        *nvel = vel;
+    }
+    
+    return ret;
+}
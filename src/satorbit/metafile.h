@@ -0,0 +1,75 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef __METAFILE_H
+#define __METAFILE_H
+
+/* Reader of DORIS .res and GAMMA .par metadata shared by daisy (C) and
+ * the satorbit library (C++). The file is mapped and indexed once, values
+ * are returned as pointers into the mapping. */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct meta_file meta_file;
+
+
+/* Maps path and indexes its "key: value" lines and sections (DORIS
+ * "*_Start_name:" ... "* End_name:" blocks). NULL if the file cannot be
+ * opened or mapped. */
+meta_file* meta_open(char const* path);
+void meta_close(meta_file* meta);
+
+
+/* Value of the first line whose key is key, optionally followed by an
+ * annotation ("First_line (w.r.t. original_image)" matches "First_line"),
+ * within section or anywhere if section is NULL. The value is not zero
+ * terminated, its length goes to len. NULL if there is no such key. */
+char const* meta_value(meta_file const* meta, char const* section,
+                       char const* key, size_t* len);
+
+
+/* Numeric values, return 0 on success, 1 if the key is missing and 2 if
+ * the value is not a number. */
+int meta_double(meta_file const* meta, char const* section,
+                char const* key, double* out);
+int meta_int(meta_file const* meta, char const* section, char const* key,
+             int* out);
+
+
+/* State vectors as t, x, y, z, vx, vy, vz rows from the precise_orbits
+ * section of a .res file (velocities are optional after t x y z) or the
+ * state_vector_* lines of a .par file. Missing velocities are NaN. sv can
+ * be NULL to query the number of state vectors only, otherwise it holds
+ * at most max rows; nvel (NULLable) receives the number of rows with
+ * velocities. Returns the number of state vectors, -1 if there are none
+ * and -2 if a record cannot be read. */
+int meta_state_vectors(meta_file const* meta, double* sv, int const max,
+                       int* nvel);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+// guard
+#endif
@@ -0,0 +1,1035 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include "orbit.h"
+
+
+using Eigen::Index;
+
+
+/* Least squares fit of x, y and z with a common design matrix, basis(tau,
+ * row) fills the deg + 1 basis functions at tau = (t - t0) / span. One
+ * Householder QR serves all three axes. */
+template<class Basis>
+static int fit(int const n, int const deg, double const* orb,
+               double const span, Basis basis, Eigen::MatrixXd& X,
+               double* mu0, Eigen::VectorXd& qdiag)
+{
+    Index const u = deg + 1;
+    double const t0 = orb[0];
+    
+    Eigen::MatrixXd A(n, u), L(n, 3);
+    Eigen::RowVectorXd row(u);
+    
+    for (Index ii = 0; ii < n; ++ii) {
+        basis((orb[4 * ii] - t0) / span, row.data());
+        A.row(ii) = row;
+        
+        L(ii, 0) = orb[4 * ii + 1];
+        L(ii, 1) = orb[4 * ii + 2];
+        L(ii, 2) = orb[4 * ii + 3];
+    }
+    
+    Eigen::HouseholderQR<Eigen::MatrixXd> const qr(A);
+    
+    Eigen::MatrixXd const R =
+        qr.matrixQR().topLeftCorner(u, u).triangularView<Eigen::Upper>();
+    
+    auto const rmax = R.diagonal().cwiseAbs().maxCoeff();
+    
+    if (R.diagonal().cwiseAbs().minCoeff() <= rmax * 1e-14) {
+        return 2;
+    }
+    
+    X = qr.solve(L);
+    
+    // diagonal of (A^T A)^-1 = R^-1 R^-T
+    Eigen::MatrixXd const I = Eigen::MatrixXd::Identity(u, u);
+    Eigen::MatrixXd const Rinv = R.triangularView<Eigen::Upper>().solve(I);
+    
+    qdiag = Rinv.rowwise().squaredNorm();
+    
+    Eigen::MatrixXd const res = A * X - L;
+    
+    for (Index cc = 0; cc < 3; ++cc) {
+        mu0[cc] = std::sqrt(res.col(cc).squaredNorm() / double(n - u));
+    }
+    
+    return 0;
+}
+
+
+// times of the state vectors are strictly increasing
+static bool increasing(int const n, double const* orb)
+{
+    for (Index ii = 1; ii < n; ++ii) {
+        if (not (orb[4 * ii] > orb[4 * (ii - 1)])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+/* Length of the arc t1 - t0 as in orbit_eval, -1 if there are not
+ * enough state vectors. */
+static double arc(int const n, int const deg, double const* orb)
+{
+    if (deg < 0 or n <= deg + 1) {
+        return -1.0;
+    }
+    
+    return orb[4 * (n - 1)] - orb[0];
+}
+
+
+/* The Vandermonde matrix is built in tau = (t - t0) / span, which keeps
+ * its columns of similar size. Coefficients in seconds are
+ * a_j = b_j / span^j. */
+int orbit_poly_fit(int const n, int const deg, double const* orb,
+                   double* coeffs, double* mu0, double* std)
+{
+    auto const span = arc(n, deg, orb);
+    
+    if (span < 0.0) {
+        return 1;
+    }
+    
+    if (not increasing(n, orb)) {
+        return 3;
+    }
+    
+    Index const u = deg + 1;
+    Eigen::MatrixXd X;
+    Eigen::VectorXd qdiag;
+    
+    auto const ret = fit(n, deg, orb, span,
+    [u](double const tau, double* row) {
+        double p = 1.0;
+        
+        for (Index jj = 0; jj < u; ++jj) {
+            row[jj] = p;
+            p *= tau;
+        }
+    }, X, mu0, qdiag);
+    
+    if (ret != 0) {
+        return ret;
+    }
+    
+    for (Index cc = 0; cc < 3; ++cc) {
+        double scale = 1.0;
+        
+        for (Index jj = 0; jj < u; ++jj) {
+            coeffs[cc * u + jj] = X(jj, cc) * scale;
+            std[cc * u + jj] = mu0[cc] * std::sqrt(qdiag(jj)) * scale;
+            scale /= span;
+        }
+    }
+    
+    return 0;
+}
+
+
+int orbit_cheb_fit(int const n, int const deg, double const* orb,
+                   double* coeffs, double* mu0, double* std)
+{
+    auto const span = arc(n, deg, orb);
+    
+    if (span < 0.0) {
+        return 1;
+    }
+    
+    if (not increasing(n, orb)) {
+        return 3;
+    }
+    
+    Index const u = deg + 1;
+    Eigen::MatrixXd X;
+    Eigen::VectorXd qdiag;
+    
+    // T_0 = 1, T_1 = x, T_j+1 = 2 x T_j - T_j-1 with x = 2 tau - 1
+    auto const ret = fit(n, deg, orb, span,
+    [u](double const tau, double* row) {
+        double const x = 2.0 * tau - 1.0;
+        
+        row[0] = 1.0;
+        
+        if (u > 1) {
+            row[1] = x;
+        }
+        
+        for (Index jj = 2; jj < u; ++jj) {
+            row[jj] = 2.0 * x * row[jj - 1] - row[jj - 2];
+        }
+    }, X, mu0, qdiag);
+    
+    if (ret != 0) {
+        return ret;
+    }
+    
+    for (Index cc = 0; cc < 3; ++cc) {
+        for (Index jj = 0; jj < u; ++jj) {
+            coeffs[cc * u + jj] = X(jj, cc);
+            std[cc * u + jj] = mu0[cc] * std::sqrt(qdiag(jj));
+        }
+    }
+    
+    return 0;
+}
+
+
+/* Uniform B-spline of degree p on the knots 0, 1, ..., p + 1. */
+static double cardinal(int const p, double const x)
+{
+    if (p == 0) {
+        return x >= 0.0 and x < 1.0 ? 1.0 : 0.0;
+    }
+    
+    return (x * cardinal(p - 1, x) + (p + 1 - x) * cardinal(p - 1, x - 1.0))
+           / p;
+}
+
+
+/* Power basis coefficients M(j, i) of the p + 1 B-splines acting on a
+ * segment, B_i(u) = sum_j M(j, i) u^j, from p + 1 samples. */
+static Eigen::MatrixXd segment_matrix(int const p)
+{
+    Eigen::MatrixXd V(p + 1, p + 1), N(p + 1, p + 1);
+    
+    for (int kk = 0; kk <= p; ++kk) {
+        double const u = (kk + 0.5) / (p + 1);
+        double pw = 1.0;
+        
+        for (int jj = 0; jj <= p; ++jj) {
+            V(kk, jj) = pw;
+            pw *= u;
+            N(kk, jj) = cardinal(p, u + p - jj);
+        }
+    }
+    
+    return V.fullPivLu().solve(N);
+}
+
+
+/* Control points of the B-spline come from the sparse normal equations
+ * (bandwidth deg), then every segment is converted to local power
+ * coefficients so that evaluation does not need the B-spline basis. */
+int orbit_spline_fit(int const n, int const deg, int const nseg,
+                     double const* orb, double* coeffs, double* mu0)
+{
+    Index const nc = nseg + deg;
+    
+    if (deg < 1 or deg > 5 or nseg < 1 or n <= nc) {
+        return 1;
+    }
+    
+    double const t0 = orb[0], span = orb[4 * (n - 1)] - t0,
+                 h = span / nseg;
+    
+    if (not increasing(n, orb)) {
+        return 3;
+    }
+    
+    auto const M = segment_matrix(deg);
+    
+    std::vector<Eigen::Triplet<double>> trip;
+    trip.reserve(n * (deg + 1));
+    
+    Eigen::MatrixXd L(n, 3);
+    Eigen::VectorXd pw(deg + 1);
+    
+    for (Index ii = 0; ii < n; ++ii) {
+        double const s = (orb[4 * ii] - t0) / h;
+        Index const kk = std::min(Index(nseg - 1),
+                                  std::max(Index(0), Index(std::floor(s))));
+        double const u = s - kk;
+        
+        pw(0) = 1.0;
+        
+        for (int jj = 1; jj <= deg; ++jj) {
+            pw(jj) = pw(jj - 1) * u;
+        }
+        
+        for (int jj = 0; jj <= deg; ++jj) {
+            trip.emplace_back(ii, kk + jj, pw.dot(M.col(jj)));
+        }
+        
+        L(ii, 0) = orb[4 * ii + 1];
+        L(ii, 1) = orb[4 * ii + 2];
+        L(ii, 2) = orb[4 * ii + 3];
+    }
+    
+    Eigen::SparseMatrix<double> A(n, nc);
+    A.setFromTriplets(trip.begin(), trip.end());
+    
+    Eigen::SparseMatrix<double> const N = A.transpose() * A;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(N);
+    
+    if (ldlt.info() != Eigen::Success) {
+        return 2;
+    }
+    
+    auto const dmax = ldlt.vectorD().cwiseAbs().maxCoeff();
+    
+    if (ldlt.vectorD().minCoeff() <= dmax * 1e-12) {
+        return 2;
+    }
+    
+    Eigen::MatrixXd const AtL = A.transpose() * L;
+    Eigen::MatrixXd const P = ldlt.solve(AtL);
+    Eigen::MatrixXd const res = A * P - L;
+    
+    Index const u = deg + 1;
+    
+    for (Index cc = 0; cc < 3; ++cc) {
+        mu0[cc] = std::sqrt(res.col(cc).squaredNorm() / double(n - nc));
+        
+        for (Index kk = 0; kk < nseg; ++kk) {
+            Eigen::VectorXd const c = M * P.col(cc).segment(kk, u);
+            
+            for (Index jj = 0; jj < u; ++jj) {
+                coeffs[(cc * nseg + kk) * u + jj] = c(jj);
+            }
+        }
+    }
+    
+    return 0;
+}
+
+
+int orbit_hermite(int const n, double const* sv, double* coeffs)
+{
+    if (n < 2) {
+        return 1;
+    }
+    
+    auto const nseg = n - 1;
+    double const t0 = sv[0], h = (sv[7 * nseg] - t0) / nseg;
+    
+    if (not (h > 0.0)) {
+        return 2;
+    }
+    
+    for (int ii = 1; ii < n; ++ii) {
+        if (std::fabs(sv[7 * ii] - t0 - ii * h) > 1e-6 * h) {
+            return 2;
+        }
+    }
+    
+    // p(u) = p0 + h v0 u + (3 (p1 - p0) - h (2 v0 + v1)) u^2
+    //           + (2 (p0 - p1) + h (v0 + v1)) u^3,  u in [0, 1]
+    for (int cc = 0; cc < 3; ++cc) {
+        for (int kk = 0; kk < nseg; ++kk) {
+            auto const a = sv + 7 * kk, b = a + 7;
+            double const p0 = a[cc + 1], p1 = b[cc + 1],
+                         v0 = h * a[cc + 4], v1 = h * b[cc + 4];
+            auto const c = coeffs + (cc * nseg + kk) * 4;
+            
+            c[0] = p0;
+            c[1] = v0;
+            c[2] = 3.0 * (p1 - p0) - 2.0 * v0 - v1;
+            c[3] = 2.0 * (p0 - p1) + v0 + v1;
+        }
+    }
+    
+    return 0;
+}
+
+
+/* Horner's scheme carrying the first two derivatives along. */
+static void eval_monomial(double const* c, int const n, double const t,
+                          double& f, double& df, double& ddf)
+{
+    f = df = ddf = 0.0;
+    
+    for (int jj = n - 1; jj >= 0; --jj) {
+        ddf = ddf * t + 2.0 * df;
+        df = df * t + f;
+        f = f * t + c[jj];
+    }
+}
+
+
+/* Clenshaw's recurrence b_k = c_k + 2 x b_k+1 - b_k+2 and its
+ * derivatives with respect to x, f = c_0 + x b_1 - b_2. */
+static void eval_chebyshev(double const* c, int const n, double const x,
+                           double& f, double& df, double& ddf)
+{
+    double b1 = 0.0, b2 = 0.0, d1 = 0.0, d2 = 0.0, e1 = 0.0, e2 = 0.0;
+    
+    for (int kk = n - 1; kk >= 1; --kk) {
+        auto const b = c[kk] + 2.0 * x * b1 - b2,
+                   d = 2.0 * b1 + 2.0 * x * d1 - d2,
+                   e = 4.0 * d1 + 2.0 * x * e1 - e2;
+        
+        b2 = b1; b1 = b;
+        d2 = d1; d1 = d;
+        e2 = e1; e1 = e;
+    }
+    
+    f = c[0] + x * b1 - b2;
+    df = b1 + x * d1 - d2;
+    ddf = 2.0 * d1 + x * e1 - e2;
+}
+
+
+/* Value at x only, for precomputed derivative coefficients. */
+static double eval_value(int const kind, double const* c, int const n,
+                         double const x)
+{
+    double f = 0.0;
+    
+    if (kind == orbit_chebyshev) {
+        double b2 = 0.0;
+        
+        for (int kk = n - 1; kk >= 1; --kk) {
+            auto const b = c[kk] + 2.0 * x * f - b2;
+            b2 = f; f = b;
+        }
+        
+        return c[0] + x * f - b2;
+    }
+    
+    for (int jj = n - 1; jj >= 0; --jj) {
+        f = f * x + c[jj];
+    }
+    
+    return f;
+}
+
+
+/* Value and derivatives of x, y and z in segment seg at argument x, dx
+ * is the derivative of the argument with respect to time. */
+static void eval_coords(orbit_poly const* orb, int const seg, double const x,
+                        double const dx, double* pos, double* vel,
+                        double* acc)
+{
+    auto const n = orb->n, kind = orb->kind, stride = orb->nseg * n;
+    auto const c = orb->coeffs + seg * n;
+    
+    if (orb->dcoeffs != nullptr) {
+        auto const d = orb->dcoeffs + seg * n;
+        
+        for (int cc = 0; cc < 3; ++cc) {
+            if (pos != nullptr) {
+                pos[cc] = eval_value(kind, c + cc * stride, n, x);
+            }
+            
+            if (vel != nullptr) {
+                vel[cc] = eval_value(kind, d + cc * stride, n, x);
+            }
+            
+            if (acc != nullptr) {
+                acc[cc] = eval_value(kind, d + (cc + 3) * stride, n, x);
+            }
+        }
+        
+        return;
+    }
+    
+    for (int cc = 0; cc < 3; ++cc) {
+        double f, df, ddf;
+        
+        if (kind == orbit_chebyshev) {
+            eval_chebyshev(c + cc * stride, n, x, f, df, ddf);
+        } else {
+            eval_monomial(c + cc * stride, n, x, f, df, ddf);
+        }
+        
+        if (pos != nullptr) {
+            pos[cc] = f;
+        }
+        
+        if (vel != nullptr) {
+            vel[cc] = df * dx;
+        }
+        
+        if (acc != nullptr) {
+            acc[cc] = ddf * dx * dx;
+        }
+    }
+}
+
+
+void orbit_eval(orbit_poly const* orb, double const dt, double* pos,
+                double* vel, double* acc)
+{
+    // derivatives of the argument with respect to time
+    double x = dt, dx = 1.0;
+    int seg = 0;
+    
+    if (orb->kind == orbit_chebyshev) {
+        dx = 2.0 / (orb->t1 - orb->t0);
+        x = dt * dx - 1.0;
+    }
+    else if (orb->kind == orbit_spline) {
+        dx = orb->nseg / (orb->t1 - orb->t0);
+        
+        auto const s = dt * dx;
+        seg = s <= 0.0 ? 0 : std::min(orb->nseg - 1, int(s));
+        x = s - seg;
+    }
+    
+    eval_coords(orb, seg, x, dx, pos, vel, acc);
+}
+
+
+void orbit_eval_sorted(orbit_poly const* orb, int const m, double const* dt,
+                       double* pos, double* vel, double* acc)
+{
+    auto const nseg = orb->nseg;
+    
+    if (orb->kind != orbit_spline) {
+        for (int ii = 0; ii < m; ++ii) {
+            orbit_eval(orb, dt[ii],
+                       pos != nullptr ? pos + 3 * ii : nullptr,
+                       vel != nullptr ? vel + 3 * ii : nullptr,
+                       acc != nullptr ? acc + 3 * ii : nullptr);
+        }
+        
+        return;
+    }
+    
+    // the segment only moves forward, every segment is visited once and
+    // its coefficients stay in cache for all the times it covers
+    double const h = (orb->t1 - orb->t0) / nseg, dx = 1.0 / h;
+    int seg = 0;
+    double start = 0.0, end = h;
+    
+    for (int ii = 0; ii < m; ++ii) {
+        auto const t = dt[ii];
+        
+        if (t < start) {
+            // out of order, fall back to direct lookup
+            auto const s = t * dx;
+            seg = s <= 0.0 ? 0 : std::min(nseg - 1, int(s));
+            start = seg * h; end = start + h;
+        }
+        
+        while (t >= end and seg < nseg - 1) {
+            ++seg;
+            start = end; end += h;
+        }
+        
+        eval_coords(orb, seg, (t - start) * dx, dx,
+                    pos != nullptr ? pos + 3 * ii : nullptr,
+                    vel != nullptr ? vel + 3 * ii : nullptr,
+                    acc != nullptr ? acc + 3 * ii : nullptr);
+    }
+}
+
+
+
+int orbit_zero_doppler(orbit_poly const* orb, double const* point,
+                       double lo, double hi, double const tol,
+                       int const max_iter, double* dt, double* sat)
+{
+    double pos[3], vel[3], acc[3];
+    double t = *dt;
+    
+    if (not (t > lo and t < hi)) {
+        t = 0.5 * (lo + hi);
+    }
+    
+    for (int ii = 1; ii <= max_iter; ++ii) {
+        orbit_eval(orb, t, pos, vel, acc);
+        
+        double const dx = pos[0] - point[0], dy = pos[1] - point[1],
+                     dz = pos[2] - point[2];
+        
+        double const vv = vel[0] * vel[0] + vel[1] * vel[1]
+                          + vel[2] * vel[2],
+                     dd = dx * dx + dy * dy + dz * dz;
+        
+        double const f = vel[0] * dx + vel[1] * dy + vel[2] * dz,
+                     df = acc[0] * dx + acc[1] * dy + acc[2] * dz + vv;
+        
+        // cosine of the angle between the velocity and the line of sight
+        if (std::abs(f) <= tol * std::sqrt(vv * dd)) {
+            *dt = t;
+            
+            if (sat != nullptr) {
+                sat[0] = pos[0]; sat[1] = pos[1]; sat[2] = pos[2];
+            }
+            
+            return ii;
+        }
+        
+        // the satellite moves past the point, f increases with time
+        if (f < 0.0) {
+            lo = t;
+        } else {
+            hi = t;
+        }
+        
+        auto const next = t - f / df;
+        
+        t = next > lo and next < hi ? next : 0.5 * (lo + hi);
+    }
+    
+    *dt = t;
+    
+    if (sat != nullptr) {
+        orbit_eval(orb, t, sat, nullptr, nullptr);
+    }
+    
+    return -1;
+}
+
+
+
+/* Values of polynomials at the arguments x of the lanes, lane l uses the
+ * coefficients starting at c + off[l]. off is NULL if all lanes share c,
+ * the coefficients are broadcast then instead of gathered. */
+static void eval_lanes(int const kind, double const* c, int const n,
+                       int const* off, double const* x, double* f)
+{
+    if (off == nullptr) {
+        if (kind == orbit_chebyshev) {
+            double b1[orbit_lanes] = {}, b2[orbit_lanes] = {};
+            
+            for (int kk = n - 1; kk >= 1; --kk) {
+                auto const ck = c[kk];
+                
+                #pragma omp simd
+                for (int ll = 0; ll < orbit_lanes; ++ll) {
+                    auto const b = ck + 2.0 * x[ll] * b1[ll] - b2[ll];
+                    b2[ll] = b1[ll]; b1[ll] = b;
+                }
+            }
+            
+            #pragma omp simd
+            for (int ll = 0; ll < orbit_lanes; ++ll) {
+                f[ll] = c[0] + x[ll] * b1[ll] - b2[ll];
+            }
+            
+            return;
+        }
+        
+        #pragma omp simd
+        for (int ll = 0; ll < orbit_lanes; ++ll) {
+            f[ll] = 0.0;
+        }
+        
+        for (int jj = n - 1; jj >= 0; --jj) {
+            auto const cj = c[jj];
+            
+            #pragma omp simd
+            for (int ll = 0; ll < orbit_lanes; ++ll) {
+                f[ll] = f[ll] * x[ll] + cj;
+            }
+        }
+        
+        return;
+    }
+    
+    // spline segments, only Horner's scheme
+    #pragma omp simd
+    for (int ll = 0; ll < orbit_lanes; ++ll) {
+        f[ll] = 0.0;
+    }
+    
+    for (int jj = n - 1; jj >= 0; --jj) {
+        #pragma omp simd
+        for (int ll = 0; ll < orbit_lanes; ++ll) {
+            f[ll] = f[ll] * x[ll] + c[off[ll] + jj];
+        }
+    }
+}
+
+
+int orbit_zero_doppler_batch(orbit_poly const* orb, int const m,
+                             double const* points, double const lo,
+                             double const hi, double const tol,
+                             int const max_iter, double* dt, double* sat,
+                             double* los, int* iter)
+{
+    int const nl = orbit_lanes;
+    auto const n = orb->n, nseg = orb->nseg, kind = orb->kind,
+               stride = nseg * n;
+    
+    // velocities and accelerations are evaluated like the positions
+    std::vector<double> own;
+    auto d = orb->dcoeffs;
+    
+    if (d == nullptr) {
+        own.resize(6 * stride);
+        orbit_derivatives(orb, own.data());
+        d = own.data();
+    }
+    
+    // argument of the polynomials, x = dt * scale + shift
+    double scale = 1.0, shift = 0.0;
+    
+    if (kind == orbit_chebyshev) {
+        scale = 2.0 / (orb->t1 - orb->t0);
+        shift = -1.0;
+    }
+    else if (kind == orbit_spline) {
+        scale = nseg / (orb->t1 - orb->t0);
+    }
+    
+    int failed = 0;
+    
+    for (int first = 0; first < m; first += nl) {
+        auto const used = std::min(nl, m - first);
+        
+        double px[nl], py[nl], pz[nl], t[nl], te[nl], a[nl], b[nl], x[nl];
+        double pos[3][nl], vel[3][nl], acc[3][nl];
+        int off[nl], count[nl], done[nl];
+        
+        for (int ll = 0; ll < nl; ++ll) {
+            // idle lanes of the last group repeat its last point
+            auto const ii = first + std::min(ll, used - 1);
+            
+            px[ll] = points[3 * ii];
+            py[ll] = points[3 * ii + 1];
+            pz[ll] = points[3 * ii + 2];
+            
+            t[ll] = dt[ii] > lo and dt[ii] < hi ? dt[ii] : 0.5 * (lo + hi);
+            te[ll] = t[ll];
+            a[ll] = lo; b[ll] = hi;
+            count[ll] = -1;
+            done[ll] = ll >= used;
+        }
+        
+        for (int it = 1; it <= max_iter; ++it) {
+            if (kind == orbit_spline) {
+                for (int ll = 0; ll < nl; ++ll) {
+                    auto const s = t[ll] * scale;
+                    auto const seg = s <= 0.0 ? 0
+                                     : std::min(nseg - 1, int(s));
+                    x[ll] = s - seg;
+                    off[ll] = seg * n;
+                }
+            } else {
+                #pragma omp simd
+                for (int ll = 0; ll < nl; ++ll) {
+                    x[ll] = t[ll] * scale + shift;
+                }
+            }
+            
+            auto const o = kind == orbit_spline ? off : nullptr;
+            
+            for (int cc = 0; cc < 3; ++cc) {
+                eval_lanes(kind, orb->coeffs + cc * stride, n, o, x, pos[cc]);
+                eval_lanes(kind, d + cc * stride, n, o, x, vel[cc]);
+                eval_lanes(kind, d + (cc + 3) * stride, n, o, x, acc[cc]);
+            }
+            
+            int active = 0;
+            
+            // the steps of orbit_zero_doppler, masked by done
+            #pragma omp simd reduction(+:active)
+            for (int ll = 0; ll < nl; ++ll) {
+                auto const dx = pos[0][ll] - px[ll], dy = pos[1][ll] - py[ll],
+                           dz = pos[2][ll] - pz[ll];
+                
+                auto const vv = vel[0][ll] * vel[0][ll]
+                                + vel[1][ll] * vel[1][ll]
+                                + vel[2][ll] * vel[2][ll],
+                           dd = dx * dx + dy * dy + dz * dz;
+                
+                auto const f = vel[0][ll] * dx + vel[1][ll] * dy
+                               + vel[2][ll] * dz,
+                           df = acc[0][ll] * dx + acc[1][ll] * dy
+                                + acc[2][ll] * dz + vv;
+                
+                int const conv = std::abs(f) <= tol * std::sqrt(vv * dd),
+                          stop = done[ll] or conv;
+                
+                auto const aa = f < 0.0 ? t[ll] : a[ll],
+                           bb = f < 0.0 ? b[ll] : t[ll];
+                
+                auto next = t[ll] - f / df;
+                next = next > aa and next < bb ? next : 0.5 * (aa + bb);
+                
+                count[ll] = conv and not done[ll] ? it : count[ll];
+                te[ll] = t[ll];
+                a[ll] = stop ? a[ll] : aa;
+                b[ll] = stop ? b[ll] : bb;
+                t[ll] = stop ? t[ll] : next;
+                done[ll] = stop;
+                active += not stop;
+            }
+            
+            if (active == 0) {
+                break;
+            }
+        }
+        
+        for (int ll = 0; ll < used; ++ll) {
+            auto const ii = first + ll;
+            
+            // te is the time of pos, it differs from t only if the lane
+            // did not converge
+            dt[ii] = te[ll];
+            
+            if (count[ll] < 0) {
+                ++failed;
+            }
+            
+            if (iter != nullptr) {
+                iter[ii] = count[ll];
+            }
+            
+            if (sat != nullptr) {
+                sat[3 * ii] = pos[0][ll];
+                sat[3 * ii + 1] = pos[1][ll];
+                sat[3 * ii + 2] = pos[2][ll];
+            }
+            
+            if (los != nullptr) {
+                auto const dx = pos[0][ll] - px[ll], dy = pos[1][ll] - py[ll],
+                           dz = pos[2][ll] - pz[ll];
+                auto const r = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz);
+                
+                los[3 * ii] = dx * r;
+                los[3 * ii + 1] = dy * r;
+                los[3 * ii + 2] = dz * r;
+            }
+        }
+    }
+    
+    return failed;
+}
+
+/* Coefficients of the derivative with respect to the argument scaled by
+ * dx, the derivative of the argument with respect to time. */
+static void derive(int const kind, double const* c, int const n,
+                   double const dx, double* d)
+{
+    d[n - 1] = 0.0;
+    
+    if (kind == orbit_chebyshev) {
+        // d_k-1 = d_k+1 + 2 k c_k, halving d_0 as f contains c_0 fully
+        double d1 = 0.0, d2 = 0.0;
+        
+        for (int kk = n - 1; kk >= 1; --kk) {
+            auto const dk = d2 + 2.0 * kk * c[kk];
+            d[kk - 1] = dk;
+            d2 = d1; d1 = dk;
+        }
+        
+        d[0] *= 0.5;
+        
+        for (int kk = 0; kk < n - 1; ++kk) {
+            d[kk] *= dx;
+        }
+    }
+    else {
+        for (int jj = 0; jj < n - 1; ++jj) {
+            d[jj] = (jj + 1) * c[jj + 1] * dx;
+        }
+    }
+}
+
+
+void orbit_derivatives(orbit_poly const* orb, double* dcoeffs)
+{
+    auto const n = orb->n, nseg = orb->nseg, stride = 3 * nseg * n;
+    double dx = 1.0;
+    
+    if (orb->kind == orbit_chebyshev) {
+        dx = 2.0 / (orb->t1 - orb->t0);
+    }
+    else if (orb->kind == orbit_spline) {
+        dx = nseg / (orb->t1 - orb->t0);
+    }
+    
+    for (int ii = 0; ii < 3 * nseg; ++ii) {
+        auto const vel = dcoeffs + ii * n;
+        
+        derive(orb->kind, orb->coeffs + ii * n, n, dx, vel);
+        derive(orb->kind, vel, n, dx, vel + stride);
+    }
+}
+
+
+struct cache_header {
+    char magic[8];
+    int32_t kind, n, nseg, reserved;
+    double t0, t1, mu0[3];
+};
+
+static_assert(sizeof(cache_header) == 64, "orbit cache header is 64 bytes");
+
+static char const cache_magic[] = "INMORB01";
+
+
+static size_t cache_size(int const n, int const nseg)
+{
+    return sizeof(cache_header) + 9 * size_t(n) * nseg * sizeof(double);
+}
+
+
+size_t orbit_cache_size(orbit_poly const* orb)
+{
+    return cache_size(orb->n, orb->nseg);
+}
+
+
+void orbit_cache_pack(orbit_poly const* orb, double const* mu0, void* out)
+{
+    auto const size = 3 * size_t(orb->n) * orb->nseg;
+    
+    cache_header head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic, cache_magic, sizeof(head.magic));
+    
+    head.kind = orb->kind; head.n = orb->n; head.nseg = orb->nseg;
+    head.t0 = orb->t0; head.t1 = orb->t1;
+    
+    if (mu0 != nullptr) {
+        std::copy(mu0, mu0 + 3, head.mu0);
+    }
+    
+    auto const data = reinterpret_cast<double*>(
+        static_cast<char*>(out) + sizeof(cache_header));
+    
+    std::memcpy(out, &head, sizeof(head));
+    std::copy(orb->coeffs, orb->coeffs + size, data);
+    orbit_derivatives(orb, data + size);
+}
+
+
+int orbit_cache_view(void const* data, size_t const size, orbit_poly* orb,
+                     double* mu0)
+{
+    if (size < sizeof(cache_header)) {
+        return 2;
+    }
+    
+    auto const head = static_cast<cache_header const*>(data);
+    
+    if (std::memcmp(head->magic, cache_magic, sizeof(head->magic)) != 0) {
+        return 2;
+    }
+    
+    // polynomials have one segment
+    if (not (head->kind == orbit_spline
+             or ((head->kind == orbit_monomial
+                  or head->kind == orbit_chebyshev) and head->nseg == 1))
+        or head->n < 1 or head->nseg < 1) {
+        return 2;
+    }
+    
+    // n x nseg blocks of 9 doubles fit into size, without overflowing
+    auto const blocks = (size - sizeof(cache_header)) / (9 * sizeof(double));
+    
+    if (blocks / size_t(head->n) < size_t(head->nseg)) {
+        return 2;
+    }
+    
+    // the data are read only, coeffs are never written through orb
+    auto const coeffs = reinterpret_cast<double*>(
+        const_cast<char*>(static_cast<char const*>(data))
+        + sizeof(cache_header));
+    
+    orb->kind = head->kind; orb->n = head->n; orb->nseg = head->nseg;
+    orb->t0 = head->t0; orb->t1 = head->t1;
+    orb->coeffs = coeffs;
+    orb->dcoeffs = coeffs + 3 * size_t(head->n) * head->nseg;
+    orb->map = nullptr;
+    
+    if (mu0 != nullptr) {
+        std::copy(head->mu0, head->mu0 + 3, mu0);
+    }
+    
+    return 0;
+}
+
+
+int orbit_cache_write(char const* path, orbit_poly const* orb,
+                      double const* mu0)
+{
+    std::vector<char> block(orbit_cache_size(orb));
+    orbit_cache_pack(orb, mu0, block.data());
+    
+    auto const out = std::fopen(path, "wb");
+    
+    if (out == nullptr) {
+        return 1;
+    }
+    
+    bool ok = std::fwrite(block.data(), 1, block.size(), out)
+              == block.size();
+    
+    ok = std::fclose(out) == 0 and ok;
+    
+    return ok ? 0 : 1;
+}
+
+
+int orbit_cache_open(char const* path, orbit_poly* orb, double* mu0)
+{
+    auto const fd = open(path, O_RDONLY);
+    
+    if (fd < 0) {
+        return 1;
+    }
+    
+    struct stat st;
+    
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 1;
+    }
+    
+    auto const size = size_t(st.st_size);
+    
+    if (size < sizeof(cache_header)) {
+        close(fd);
+        return 2;
+    }
+    
+    auto const map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (map == MAP_FAILED) {
+        return 1;
+    }
+    
+    // orb is left untouched if the file is not an orbit cache
+    orbit_poly view;
+    double head_mu0[3];
+    
+    if (orbit_cache_view(map, size, &view, head_mu0) != 0
+        or size != orbit_cache_size(&view)) {
+        munmap(map, size);
+        return 2;
+    }
+    
+    *orb = view;
+    orb->map = map;
+    
+    if (mu0 != nullptr) {
+        std::copy(head_mu0, head_mu0 + 3, mu0);
+    }
+    
+    return 0;
+}
+
+
+void orbit_cache_close(orbit_poly* orb)
+{
+    if (orb->map != nullptr) {
+        munmap(orb->map, cache_size(orb->n, orb->nseg));
+        orb->map = nullptr;
+        orb->coeffs = orb->dcoeffs = nullptr;
+    }
+}
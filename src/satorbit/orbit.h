@@ -0,0 +1,193 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __ORBIT_H
+#define __ORBIT_H
+
+/* Orbit fitting shared by daisy (C) and the satorbit library (C++). */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Kinds of orbit polynomials, the first line of a .porb file holds the
+ * degree followed by "chebyshev" for Chebyshev series or "spline" for
+ * piecewise polynomials. */
+enum { orbit_monomial = 0, orbit_chebyshev = 1, orbit_spline = 2 };
+
+
+/* Fitted orbit. Time is measured from t0 (the first state vector); a
+ * monomial orbit is sum c_j dt^j, a Chebyshev orbit is sum c_j T_j(tau)
+ * with tau = 2 dt / (t1 - t0) - 1 in [-1, 1] over the fitted arc.
+ * A spline orbit has nseg segments of length h = (t1 - t0) / nseg, the
+ * k-th one is sum c_kj u^j with u = dt / h - k in [0, 1]. */
+typedef struct {
+    int kind;        // orbit_monomial, orbit_chebyshev or orbit_spline
+    int n;           // number of coefficients per coordinate and segment
+                     // (degree + 1)
+    int nseg;        // number of segments, 1 for polynomials
+    double t0, t1;   // times of the first and last state vectors
+    double * coeffs; // 3 x nseg x n coefficients of x, y and z
+    double * dcoeffs; // NULL or 2 x 3 x nseg x n coefficients of the
+                      // velocity and acceleration, see orbit_derivatives
+    void * map;      // mapping of a binary orbit cache, NULL otherwise
+} orbit_poly;
+
+
+/* Least squares fit of polynomials of degree deg to n state vectors.
+ * orb holds rows of t, x, y, z (the layout of torb in daisy), time is
+ * measured from the first state vector as in the .porb files.
+ * 
+ * coeffs: 3 x (deg + 1) polynomial coefficients of x, y and z
+ * mu0:    3 standard deviations of unit weight
+ * std:    3 x (deg + 1) standard deviations of the coefficients
+ * 
+ * Returns 0 on success, 1 if there are not enough state vectors, 2 if
+ * the problem is singular and 3 if the times of the state vectors are
+ * not strictly increasing. */
+int orbit_poly_fit(int const n, int const deg, double const* orb,
+                   double* coeffs, double* mu0, double* std);
+
+
+/* Least squares fit of Chebyshev series of degree deg, arguments and
+ * return value are the same as for orbit_poly_fit. */
+int orbit_cheb_fit(int const n, int const deg, double const* orb,
+                   double* coeffs, double* mu0, double* std);
+
+
+/* Least squares fit of a spline of degree deg (3: cubic, 5: quintic)
+ * with nseg uniform segments between the first and last state vectors.
+ * coeffs receives 3 x nseg x (deg + 1) local polynomial coefficients,
+ * mu0 the 3 standard deviations of unit weight. Returns 0 on success,
+ * 1 if the arguments are invalid or there are not enough state vectors,
+ * 2 if some segments are not constrained by the state vectors and 3 if
+ * the times of the state vectors are not strictly increasing. */
+int orbit_spline_fit(int const n, int const deg, int const nseg,
+                     double const* orb, double* coeffs, double* mu0);
+
+
+/* Cubic Hermite interpolation of n evenly spaced state vectors given as
+ * t, x, y, z, vx, vy, vz rows: positions and velocities are matched at
+ * both ends of every interval, no global fit is involved. coeffs
+ * receives 3 x (n - 1) x 4 coefficients of a spline orbit with n - 1
+ * segments. Returns 0 on success, 1 if n < 2 and 2 if the state vectors
+ * are not evenly spaced. */
+int orbit_hermite(int const n, double const* sv, double* coeffs);
+
+
+/* Position, velocity and acceleration at dt seconds after t0. Horner's
+ * scheme for monomials and spline segments (the segment is indexed
+ * directly from dt), Clenshaw's recurrence for Chebyshev series; any of
+ * pos, vel and acc can be NULL. */
+void orbit_eval(orbit_poly const* orb, double const dt, double* pos,
+                double* vel, double* acc);
+
+
+/* Velocity and acceleration coefficients of orb, already in time units
+ * and of the same kind and size as the positions (padded with zeros).
+ * Once orb->dcoeffs points to them orbit_eval does not need to carry
+ * derivatives along. */
+void orbit_derivatives(orbit_poly const* orb, double* dcoeffs);
+
+
+/* Binary orbit cache (.borb): a 64 byte header (the magic "INMORB01",
+ * int32 kind, n, nseg and a reserved one, double t0, t1 and mu0[3])
+ * followed by coeffs and the precomputed dcoeffs in native byte order.
+ * mu0 can be NULL for both functions.
+ * 
+ * orbit_cache_write returns 0 on success and 1 on I/O errors.
+ * orbit_cache_open maps the file read only and points coeffs and
+ * dcoeffs into the mapping; returns 0 on success, 1 if the file cannot
+ * be opened or mapped and 2 if it is not an orbit cache: wrong magic,
+ * unknown kind, n or nseg < 1 (or nseg != 1 for polynomials), or a
+ * size that does not match the header. */
+int orbit_cache_write(char const* path, orbit_poly const* orb,
+                      double const* mu0);
+int orbit_cache_open(char const* path, orbit_poly* orb, double* mu0);
+void orbit_cache_close(orbit_poly* orb);
+
+
+/* The same layout in memory, e.g. blocks of an orbit catalogue:
+ * orbit_cache_pack writes orbit_cache_size(orb) bytes to out,
+ * orbit_cache_view points orb into a block of size bytes (orb->map stays
+ * NULL) and returns 0 on success and 2 if it is not an orbit cache
+ * (see above, the block can be longer than the cache). */
+size_t orbit_cache_size(orbit_poly const* orb);
+void orbit_cache_pack(orbit_poly const* orb, double const* mu0, void* out);
+int orbit_cache_view(void const* data, size_t const size, orbit_poly* orb,
+                     double* mu0);
+
+
+/* orbit_eval at m times dt sorted in ascending order; pos, vel and acc
+ * receive m rows of x, y and z. Spline segments are walked forward
+ * instead of being looked up for every time. */
+void orbit_eval_sorted(orbit_poly const* orb, int const m, double const* dt,
+                       double* pos, double* vel, double* acc);
+
+
+
+/* Zero-Doppler (closest approach) time of the ground point (x, y, z):
+ * the root of f = v . (s - p) between lo and hi seconds after t0. Newton
+ * steps use f' = a . (s - p) + |v|^2; a step leaving the bracket narrowed
+ * by the signs of f is replaced by bisection. The solve stops when the
+ * cosine of the angle between v and s - p is at most tol.
+ * 
+ * dt:  starting time on entry (the middle of the bracket if it is
+ *      outside), the zero-Doppler time on return
+ * sat: NULL or the satellite position at dt
+ * 
+ * Returns the number of orbit evaluations or -1 if there is no
+ * convergence within max_iter iterations. */
+int orbit_zero_doppler(orbit_poly const* orb, double const* point,
+                       double lo, double hi, double const tol,
+                       int const max_iter, double* dt, double* sat);
+
+
+/* orbit_zero_doppler_batch solves orbit_lanes points at a time, 8 doubles
+ * fill an AVX-512 register or two AVX2 ones. */
+enum { orbit_lanes = 8 };
+
+
+/* orbit_zero_doppler for m ground points given as rows of x, y and z. The
+ * points of a group are solved in lock-step with vectorised orbit
+ * evaluations, lanes that converged are masked out until all lanes of
+ * the group are done.
+ * 
+ * dt:   m starting times (NaN: the middle of the bracket), zero-Doppler
+ *       times on return
+ * sat:  NULL or m rows of satellite positions
+ * los:  NULL or m rows of unit vectors from the points to the satellite
+ * iter: NULL or m numbers of orbit evaluations, -1 where there is no
+ *       convergence within max_iter iterations (dt, sat and los are the
+ *       last estimates there)
+ * 
+ * Returns the number of points without convergence. */
+int orbit_zero_doppler_batch(orbit_poly const* orb, int const m,
+                             double const* points, double const lo,
+                             double const hi, double const tol,
+                             int const max_iter, double* dt, double* sat,
+                             double* los, int* iter);
+
+#ifdef __cplusplus
+}
+#endif
+
+// guard
+#endif
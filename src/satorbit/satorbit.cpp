@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <vector>
+
 #include "satorbit.hpp"
-#include "math.hpp"
-#include "array.hpp"
+#include "orbit.h"
 
 
 static Ellipsoid const* ellipsoid = nullptr;
@@ -8,171 +13,20 @@ static Ellipsoid const* ellipsoid = nullptr;
 
 using namespace consts;
 
-#if 0
+using aux::idx;
+using aux::arr_in;
+using aux::arr_out;
+
 
-static inline double norm(cdouble x, cdouble y, cdouble z)
+static inline double norm(double const x, double const y, double const z)
 {
     return sqrt(x * x + y * y + z * z);
 }
 
-// Calculate satellite position based on fitted polynomial orbits at time
-
-static inline void calc_pos(fit_poly const& orb, double time, cart& pos)
-{
-    size_t n_poly = orb.deg + 1, is_centered = orb.is_centered;
-    double x = 0.0, y = 0.0, z = 0.0;
-    
-    View<double> const& coeffs = orb.coeffs;
-    double const *mean_coords = orb.mean_coords;
-    
-    if (is_centered)
-        time -= orb.mean_t;
-    
-    if(n_poly == 2) {
-        x = coeffs(0, 0) * time + coeffs(0, 1);
-        y = coeffs(1, 0) * time + coeffs(1, 1);
-        z = coeffs(2, 0) * time + coeffs(2, 1);
-    }
-    else {
-        x = coeffs(0, 0)  * time;
-        y = coeffs(1, 0)  * time;
-        z = coeffs(2, 0)  * time;
-
-        m_for1(ii, 1, n_poly - 1) {
-            x = (x + coeffs(0, ii)) * time;
-            y = (y + coeffs(1, ii)) * time;
-            z = (z + coeffs(2, ii)) * time;
-        }
-        
-        x += coeffs(0, n_poly - 1);
-        y += coeffs(1, n_poly - 1);
-        z += coeffs(2, n_poly - 1);
-    }
-    
-    if (is_centered) {
-        x += mean_coords[0];
-        y += mean_coords[1];
-        z += mean_coords[2];
-    }
-    
-    pos.x = x; pos.y = y; pos.z = z;
-} // calc_pos
-
-
-static inline double dot_product(fit_poly const& orb, cdouble X, cdouble Y,
-                                 cdouble Z, double time)
-{
-    /* Calculate dot product between satellite velocity vector and
-     * and vector between ground position and satellite position. */
-    
-    double dx, dy, dz, sat_x = 0.0, sat_y = 0.0, sat_z = 0.0,
-                       vel_x, vel_y, vel_z, power, inorm;
-    size_t n_poly = orb.deg + 1;
-    
-    View<double> const& coeffs = orb.coeffs;
-    double const *mean_coords = orb.mean_coords;
-    
-    if (orb.is_centered)
-        time -= orb.mean_t;
-    
-    // linear case 
-    if(n_poly == 2) {
-        sat_x = coeffs(0, 0) * time + coeffs(0, 1);
-        sat_y = coeffs(1, 0) * time + coeffs(1, 1);
-        sat_z = coeffs(2, 0) * time + coeffs(2, 1);
-        
-        vel_x = coeffs(0, 0);
-        vel_y = coeffs(1, 0);
-        vel_z = coeffs(2, 0);
-    }
-    // evaluation of polynom with Horner's method
-    else {
-        sat_x = coeffs(0, 0)  * time;
-        sat_y = coeffs(1, 0)  * time;
-        sat_z = coeffs(2, 0)  * time;
-
-        m_for1(ii, 1, n_poly - 1) {
-            sat_x = (sat_x + coeffs(0, ii)) * time;
-            sat_y = (sat_y + coeffs(1, ii)) * time;
-            sat_z = (sat_z + coeffs(2, ii)) * time;
-        }
-        
-        sat_x += coeffs(0, n_poly - 1);
-        sat_y += coeffs(1, n_poly - 1);
-        sat_z += coeffs(2, n_poly - 1);
-
-        vel_x = coeffs(0, n_poly - 2);
-        vel_y = coeffs(1, n_poly - 2);
-        vel_z = coeffs(2, n_poly - 2);
-        
-        m_for1(ii, 0, n_poly - 3) {
-            power = double(n_poly - 1.0 - ii);
-            vel_x += ii * coeffs(0, ii) * pow(time, power);
-            vel_y += ii * coeffs(1, ii) * pow(time, power);
-            vel_z += ii * coeffs(2, ii) * pow(time, power);
-        }
-    }
-    
-    if (orb.is_centered) {
-        sat_x += mean_coords[0];
-        sat_y += mean_coords[1];
-        sat_z += mean_coords[2];
-    }
-    
-    // satellite coordinates - GNSS coordinates
-    dx = sat_x - X;
-    dy = sat_y - Y;
-    dz = sat_z - Z;
-    
-    // product of inverse norms
-    inorm = (1.0 / norm(dx, dy, dz)) * (1.0 / norm(vel_x, vel_y, vel_z));
-    
-    return (vel_x * dx  + vel_y * dy  + vel_z * dz) * inorm;
-} // dot_product
-
-
-// Compute the sat position using closest approche.
-static inline void closest_appr(fit_poly const& orb, cdouble X, cdouble Y,
-                                cdouble Z, size_t max_iter, cart& sat_pos)
-{
-    // first, last and middle time, extending the time window by 5 seconds
-    double t_start = orb.start_t - 5.0,
-           t_stop  = orb.stop_t + 5.0,
-           t_middle = 0.0;
-    
-    // dot products
-    double dot_start, dot_middle = 1.0;
-
-    // iteration counter
-    size_t itr = 0;
-    
-    dot_start = dot_product(orb, X, Y, Z, t_start);
-    
-    while (abs(dot_middle) > 1.0e-11 and itr < max_iter) {
-        t_middle = (t_start + t_stop) / 2.0;
-
-        dot_middle = dot_product(orb, X, Y, Z, t_middle);
-        
-        // change start for middle
-        if ((dot_start * dot_middle) > 0.0) {
-            t_start = t_middle;
-            dot_start = dot_middle;
-        }
-        // change  end  for middle
-        else
-            t_stop = t_middle;
-
-        itr++;
-    } // while
-    
-    // calculate satellite position at middle time
-    calc_pos(orb, t_middle, sat_pos);
-} // closest_appr
-
-
-void ell_cart(cdouble lon, cdouble lat, cdouble h,
-              double& x, double& y, double& z)
+static void ell_cart(double const lon, double const lat, double const h,
+                     double& x, double& y, double& z)
 {
+    double const WA = ellipsoid->a, E2 = ellipsoid->e2;
     double n = WA / sqrt(1.0 - E2 * sin(lat) * sin(lat));
 
     x = (              n + h) * cos(lat) * cos(lon);
@@ -182,9 +36,10 @@ void ell_cart(cdouble lon, cdouble lat, cdouble h,
 } // ell_cart
 
 
-void cart_ell(cdouble x, cdouble y, cdouble z,
-              double& lon, double& lat, double& h)
+static void cart_ell(double const x, double const y, double const z,
+                     double& lon, double& lat, double& h)
 {
+    double const WA = ellipsoid->a, WB = ellipsoid->b;
     double n, p, o, so, co;
 
     n = (WA * WA - WB * WB);
@@ -205,19 +60,14 @@ void cart_ell(cdouble x, cdouble y, cdouble z,
 
 
 
-static inline void _azi_inc(fit_poly const& orb, cdouble X, cdouble Y,
-                            cdouble Z, cdouble lon, cdouble lat,
-                            size_t max_iter, double& azi, double& inc)
+static inline void _azi_inc(double const* los, double const lon,
+                            double const lat, double& azi, double& inc)
 {
-    double xf, yf, zf, xl, yl, zl, t0;
-    cart sat;
-    
-    // satellite closest approache cooridantes
-    closest_appr(orb, X, Y, Z, max_iter, sat);
+    double xl, yl, zl, t0;
     
-    xf = sat.x - X;
-    yf = sat.y - Y;
-    zf = sat.z - Z;
+    // los: unit vector from the point to the satellite at closest
+    // approache
+    double const xf = los[0], yf = los[1], zf = los[2];
     
     // estiamtion of azimuth and inclination
     xl = - sin(lat) * cos(lon) * xf
@@ -234,7 +84,7 @@ static inline void _azi_inc(fit_poly const& orb, cdouble X, cdouble Y,
     
     if(xl == 0.0) xl = 0.000000001;
     
-    double temp_azi = atan(abs(yl / xl));
+    double temp_azi = atan(std::abs(yl / xl));
     
     if( (xl < 0.0) && (yl > 0.0) ) temp_azi = consts::pi - temp_azi;
     if( (xl < 0.0) && (yl < 0.0) ) temp_azi = consts::pi + temp_azi;
@@ -252,47 +102,123 @@ static inline void _azi_inc(fit_poly const& orb, cdouble X, cdouble Y,
 // _azi_inc
 
 
-void calc_azi_inc(cref<fit_poly>  orb, arr_in coords, arr_out azi_inc,
-                  size_t const max_iter, int const is_lonlat)
+extern "C" {
+
+int calc_azi_inc(orbit_poly const* orb, arr_in coords, arr_out azi_inc,
+                 double const tol, idx const max_iter, int const is_lonlat)
 {
-    double X, Y, Z, lon, lat, h;
-    X = Y = Z = lon = lat = h = 0.0;
-    
-    size_t nrows = coords.shape(0);
-    
-    // coords contains lon, lat, h
-    if (is_lonlat) {
-        m_for(ii, nrows) {
-            lon = coords(ii, 0) * deg2rad;
-            lat = coords(ii, 1) * deg2rad;
-            h   = coords(ii, 2);
+    try {
+        double X, Y, Z, lon, lat, h;
+        X = Y = Z = lon = lat = h = 0.0;
+        
+        if (ellipsoid == nullptr) {
+            throw std::runtime_error("Ellipsoid is not set!");
+        }
+        
+        auto const vcoords = coords.const_view<double>(2);
+        auto vazi_inc = azi_inc.view<double>(2);
+        
+        idx const nrows = vcoords.shape(0);
+        
+        if (vcoords.shape(1) != 3 or vazi_inc.shape(0) != nrows or
+            vazi_inc.shape(1) != 2) {
+            throw std::runtime_error("coords should have 3 columns, azi_inc "
+                                     "2 columns and the same number of rows!");
+        }
+        
+        // zero-Doppler times of orbit_lanes points are solved at once,
+        // extending the time window by 5 seconds; the last estimate is
+        // kept if there is no convergence
+        idx const nl = orbit_lanes;
+        double xyz[3 * nl], los[3 * nl], dt[nl], lons[nl], lats[nl];
+        
+        for (idx first = 0; first < nrows; first += nl) {
+            auto const m = std::min(nl, nrows - first);
             
-            // calulate surface WGS-84 Cartesian coordinates
-            ell_cart(lon, lat, h, X, Y, Z);
+            for (idx jj = 0; jj < m; ++jj) {
+                auto const ii = first + jj;
+                
+                // coords contains lon, lat, h
+                if (is_lonlat) {
+                    lon = vcoords(ii, 0) * deg2rad;
+                    lat = vcoords(ii, 1) * deg2rad;
+                    h   = vcoords(ii, 2);
+                    
+                    // calulate surface WGS-84 Cartesian coordinates
+                    ell_cart(lon, lat, h, X, Y, Z);
+                }
+                // coords contains X, Y, Z
+                else {
+                    X = vcoords(ii, 0);
+                    Y = vcoords(ii, 1);
+                    Z = vcoords(ii, 2);
+                    
+                    // calulate surface WGS-84 geodetic coordinates
+                    cart_ell(X, Y, Z, lon, lat, h);
+                }
+                
+                xyz[3 * jj] = X; xyz[3 * jj + 1] = Y; xyz[3 * jj + 2] = Z;
+                lons[jj] = lon; lats[jj] = lat;
+                dt[jj] = std::nan("");
+            } // for
             
-            _azi_inc(orb, X, Y, Z, lon, lat, max_iter,
-                    azi_inc(ii, 0), azi_inc(ii, 1));
+            orbit_zero_doppler_batch(orb, int(m), xyz, -5.0,
+                                     orb->t1 - orb->t0 + 5.0, tol,
+                                     int(max_iter), dt, nullptr, los,
+                                     nullptr);
             
+            for (idx jj = 0; jj < m; ++jj) {
+                _azi_inc(los + 3 * jj, lons[jj], lats[jj],
+                         vazi_inc(first + jj, 0), vazi_inc(first + jj, 1));
+            }
         } // for
+        
+        return 0;
     }
-    // coords contains X, Y, Z
-    else {
-        m_for(ii, nrows) {
-            X = coords(ii, 0);
-            Y = coords(ii, 1);
-            Z = coords(ii, 2);
-            
-            // calulate surface WGS-84 geodetic coordinates
-            cart_ell(X, Y, Z, lon, lat, h);
+    catch(std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+
+int orbit_states(orbit_poly const* orb, arr_in time, arr_out states)
+{
+    try {
+        auto const vtime = time.const_view<double>(1);
+        auto vstates = states.view<double>(2);
         
-            _azi_inc(orb, X, Y, Z, lon, lat, max_iter,
-                    azi_inc(ii, 0), azi_inc(ii, 1));
-        } // for
-    } // if
+        idx const m = vtime.shape(0);
+        
+        if (vstates.shape(0) != m or vstates.shape(1) != 6) {
+            throw std::runtime_error("states should have 6 columns and as "
+                                     "many rows as time!");
+        }
+        
+        std::vector<double> dt(m), pos(3 * m), vel(3 * m);
+        
+        for (idx ii = 0; ii < m; ++ii) {
+            dt[ii] = vtime(ii) - orb->t0;
+        }
+        
+        orbit_eval_sorted(orb, int(m), dt.data(), pos.data(), vel.data(),
+                          nullptr);
+        
+        for (idx ii = 0; ii < m; ++ii) {
+            for (idx jj = 0; jj < 3; ++jj) {
+                vstates(ii, jj) = pos[3 * ii + jj];
+                vstates(ii, jj + 3) = vel[3 * ii + jj];
+            }
+        }
+        
+        return 0;
+    }
+    catch(std::exception& e) {
+        std::cerr << "Exception caught: " << e.what() << "\n";
+        return 1;
+    }
 }
-#endif
 
-extern "C" {
 
 void print_ellipsoid()
 {
@@ -0,0 +1,337 @@
+/* Regression checks of the zero-Doppler solvers on the precise orbits of
+ * .res or .par files, e.g. from src:
+ * 
+ *     test_orbit ../daisy_test_data/asc_master.res \
+ *                ../daisy_test_data/dsc_master.res
+ * 
+ * Every orbit is fitted with monomials, a Chebyshev series and a cubic
+ * spline. Prints ok or FAILED for every check, the exit status is the
+ * number of failed checks. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "metafile.h"
+#include "orbit.h"
+
+
+static int failed = 0;
+
+
+static void report(std::string const& what, bool const ok)
+{
+    std::printf("%-60s %s\n", what.c_str(), ok ? "ok" : "FAILED");
+    
+    if (not ok) {
+        failed++;
+    }
+}
+
+
+/* Fitted orbit, coeffs and dcoeffs of orb point into the vectors. */
+struct fitted {
+    orbit_poly orb;
+    std::vector<double> coeffs, dcoeffs;
+    std::string name;
+};
+
+
+static bool fit(std::vector<double> const& txyz, int const kind,
+                int const deg, fitted& out)
+{
+    int const n = int(txyz.size() / 4);
+    int const nseg = kind == orbit_spline ? (n - deg - 1) / 2 : 1;
+    double mu0[3];
+    std::vector<double> sd(3 * (deg + 1));
+    
+    out.coeffs.assign(3 * nseg * (deg + 1), 0.0);
+    out.dcoeffs.assign(6 * nseg * (deg + 1), 0.0);
+    out.orb = {kind, deg + 1, nseg, txyz[0], txyz[4 * (n - 1)],
+               out.coeffs.data(), nullptr, nullptr};
+    
+    int ret = 0;
+    
+    if (kind == orbit_spline) {
+        ret = orbit_spline_fit(n, deg, nseg, txyz.data(), out.orb.coeffs,
+                               mu0);
+    }
+    else if (kind == orbit_chebyshev) {
+        ret = orbit_cheb_fit(n, deg, txyz.data(), out.orb.coeffs, mu0,
+                             sd.data());
+    }
+    else {
+        ret = orbit_poly_fit(n, deg, txyz.data(), out.orb.coeffs, mu0,
+                             sd.data());
+    }
+    
+    if (ret != 0) {
+        return false;
+    }
+    
+    orbit_derivatives(&out.orb, out.dcoeffs.data());
+    out.orb.dcoeffs = out.dcoeffs.data();
+    
+    return true;
+}
+
+
+/* m ground points along the arc, 200 km and farther (4 km more for every
+ * point) from the ground track on alternating sides, as rows of x, y
+ * and z. */
+static std::vector<double> ground_points(orbit_poly const* orb, int const m)
+{
+    double const R = 6371e3;
+    std::vector<double> points(3 * m);
+    
+    for (int ii = 0; ii < m; ++ii) {
+        double pos[3], vel[3];
+        double const dt = (orb->t1 - orb->t0) * (0.05 + 0.9 * ii / (m - 1));
+        
+        orbit_eval(orb, dt, pos, vel, nullptr);
+        
+        // cross-track unit vector pos x vel
+        double c[] = {pos[1] * vel[2] - pos[2] * vel[1],
+                      pos[2] * vel[0] - pos[0] * vel[2],
+                      pos[0] * vel[1] - pos[1] * vel[0]};
+        
+        double const r = std::sqrt(pos[0] * pos[0] + pos[1] * pos[1]
+                                   + pos[2] * pos[2]),
+                     cn = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]),
+                     off = (ii % 2 ? 1.0 : -1.0) * (200e3 + 4e3 * ii);
+        
+        for (int cc = 0; cc < 3; ++cc) {
+            points[3 * ii + cc] = R * pos[cc] / r + off * c[cc] / cn;
+        }
+    }
+    
+    return points;
+}
+
+
+/* A point behind the start of the arc, its zero-Doppler time is before
+ * t0. */
+static void behind_arc(orbit_poly const* orb, double* point)
+{
+    double pos[3], vel[3];
+    
+    orbit_eval(orb, 0.0, pos, vel, nullptr);
+    
+    for (int cc = 0; cc < 3; ++cc) {
+        point[cc] = pos[cc] - 100.0 * vel[cc];
+    }
+}
+
+
+/* The former solver of daisy: bisection of the whole arc until the
+ * cosine of the angle between the velocity and the line of sight is at
+ * most tol. Returns the number of orbit evaluations, -1 after 200. */
+static int bisection(orbit_poly const* orb, double const* point,
+                     double const tol, double* dt)
+{
+    auto doppler = [&](double const t) {
+        double pos[3], vel[3];
+        
+        orbit_eval(orb, t, pos, vel, nullptr);
+        
+        double const dx = pos[0] - point[0], dy = pos[1] - point[1],
+                     dz = pos[2] - point[2];
+        
+        return (vel[0] * dx + vel[1] * dy + vel[2] * dz)
+               / std::sqrt(vel[0] * vel[0] + vel[1] * vel[1]
+                           + vel[2] * vel[2])
+               / std::sqrt(dx * dx + dy * dy + dz * dz);
+    };
+    
+    double tf = 0.0, tl = orb->t1 - orb->t0, vs = doppler(tf);
+    
+    for (int ii = 2; ii <= 200; ++ii) {
+        double const tm = 0.5 * (tf + tl), vm = doppler(tm);
+        
+        if (std::abs(vm) <= tol) {
+            *dt = tm;
+            return ii;
+        }
+        
+        if (vs * vm > 0.0) {
+            tf = tm;
+            vs = vm;
+        } else {
+            tl = tm;
+        }
+    }
+    
+    return -1;
+}
+
+
+/* orbit_zero_doppler converges to the bisection time with fewer orbit
+ * evaluations, and gives up on a point outside of the arc. */
+static void check_newton(fitted const& ff, std::vector<double> const& points)
+{
+    double const tol = 1e-11, arc = ff.orb.t1 - ff.orb.t0;
+    int const m = int(points.size() / 3);
+    int nconv = 0, nmax = 0, nsum = 0, bsum = 0;
+    double maxdiff = 0.0;
+    
+    for (int ii = 0; ii < m; ++ii) {
+        double tn = NAN, tb = NAN;
+        
+        auto const nn = orbit_zero_doppler(&ff.orb, &points[3 * ii], 0.0,
+                                           arc, tol, 50, &tn, nullptr);
+        auto const nb = bisection(&ff.orb, &points[3 * ii], tol, &tb);
+        
+        if (nn < 0 or nb < 0) {
+            continue;
+        }
+        
+        nconv++;
+        nmax = std::max(nmax, nn);
+        nsum += nn;
+        bsum += nb;
+        maxdiff = std::max(maxdiff, std::abs(tn - tb));
+    }
+    
+    std::printf("%s: %.2f evaluations per point (bisection %.2f), "
+                "largest time difference %.2g s\n", ff.name.c_str(),
+                double(nsum) / m, double(bsum) / m, maxdiff);
+    
+    report(ff.name + ": every point converges", nconv == m);
+    report(ff.name + ": same time as bisection (1e-6 s)", maxdiff <= 1e-6);
+    report(ff.name + ": at most 8 evaluations per point", nmax <= 8);
+    report(ff.name + ": a quarter of the evaluations of bisection",
+           4 * nsum <= bsum);
+    
+    double behind[3], tn = NAN;
+    behind_arc(&ff.orb, behind);
+    
+    report(ff.name + ": no convergence outside of the arc",
+           orbit_zero_doppler(&ff.orb, behind, 0.0, arc, tol, 50, &tn,
+                              nullptr) == -1);
+}
+
+
+/* orbit_zero_doppler_batch gives the times, positions and numbers of
+ * evaluations of orbit_zero_doppler lane by lane, from the middle of the
+ * arc and from given starting times, with a lane that does not converge
+ * and a partial last group. */
+static void check_batch(fitted const& ff, std::vector<double> points)
+{
+    double const tol = 1e-11, arc = ff.orb.t1 - ff.orb.t0;
+    double behind[3];
+    
+    behind_arc(&ff.orb, behind);
+    points.insert(points.begin() + 3 * 5, behind, behind + 3);
+    
+    int const m = int(points.size() / 3);
+    std::vector<double> start(m, NAN);
+    
+    for (int warm = 0; warm < 2; ++warm) {
+        std::vector<double> tn(start), sn(3 * m), tb(start), sb(3 * m),
+                            los(3 * m);
+        std::vector<int> nn(m), nb(m);
+        int nfail = 0;
+        
+        for (int ii = 0; ii < m; ++ii) {
+            nn[ii] = orbit_zero_doppler(&ff.orb, &points[3 * ii], 0.0, arc,
+                                        tol, 50, &tn[ii], &sn[3 * ii]);
+            nfail += nn[ii] < 0;
+        }
+        
+        auto const ret = orbit_zero_doppler_batch(&ff.orb, m, points.data(),
+                                                  0.0, arc, tol, 50,
+                                                  tb.data(), sb.data(),
+                                                  los.data(), nb.data());
+        
+        bool same = ret == nfail and nfail == 1;
+        double maxlos = 0.0;
+        
+        for (int ii = 0; ii < m; ++ii) {
+            same = same and nb[ii] == nn[ii];
+            
+            if (nn[ii] < 0) {
+                continue;
+            }
+            
+            same = same and tb[ii] == tn[ii];
+            
+            double const dx = sb[3 * ii] - points[3 * ii],
+                         dy = sb[3 * ii + 1] - points[3 * ii + 1],
+                         dz = sb[3 * ii + 2] - points[3 * ii + 2],
+                         d = std::sqrt(dx * dx + dy * dy + dz * dz);
+            
+            for (int cc = 0; cc < 3; ++cc) {
+                same = same and sb[3 * ii + cc] == sn[3 * ii + cc];
+            }
+            
+            maxlos = std::max({maxlos, std::abs(los[3 * ii] - dx / d),
+                               std::abs(los[3 * ii + 1] - dy / d),
+                               std::abs(los[3 * ii + 2] - dz / d)});
+        }
+        
+        auto const from = warm ? ", from given times" : ", from the middle";
+        
+        report(ff.name + ": batch equals scalar" + from, same);
+        report(ff.name + ": batch line of sight" + from, maxlos <= 1e-12);
+        
+        // warm start half a second off the solution
+        for (int ii = 0; ii < m; ++ii) {
+            start[ii] = tn[ii] + 0.5;
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: test_orbit master.res ...\n");
+        return 1;
+    }
+    
+    for (int aa = 1; aa < argc; ++aa) {
+        auto const meta = meta_open(argv[aa]);
+        int const n = meta != nullptr
+                      ? meta_state_vectors(meta, nullptr, 0, nullptr) : -1;
+        
+        if (n < 1) {
+            std::fprintf(stderr, "no state vectors in %s\n", argv[aa]);
+            return 1;
+        }
+        
+        std::vector<double> sv(7 * n), txyz(4 * n);
+        meta_state_vectors(meta, sv.data(), n, nullptr);
+        meta_close(meta);
+        
+        for (int ii = 0; ii < n; ++ii) {
+            std::copy(&sv[7 * ii], &sv[7 * ii] + 4, &txyz[4 * ii]);
+        }
+        
+        struct { int kind, deg; char const* name; } const kinds[] = {
+            {orbit_monomial, 4, "monomial"},
+            {orbit_chebyshev, 8, "chebyshev"},
+            {orbit_spline, 3, "spline"}
+        };
+        
+        for (auto const& kk : kinds) {
+            fitted ff;
+            std::string const path = argv[aa];
+            ff.name = path.substr(path.find_last_of('/') + 1) + " "
+                      + kk.name;
+            
+            if (not fit(txyz, kk.kind, kk.deg, ff)) {
+                report(ff.name + ": fit", false);
+                continue;
+            }
+            
+            auto const points = ground_points(&ff.orb, 101);
+            
+            check_newton(ff, points);
+            check_batch(ff, points);
+        }
+    }
+    
+    return failed;
+}
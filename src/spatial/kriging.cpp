@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <Eigen/Dense>
+
+#include "kriging.hpp"
+
+
+namespace spatial {
+
+
+double Variogram::operator()(double const h) const
+{
+    if (h <= 0.0) {
+        return 0.0;
+    }
+    
+    auto const t = h / range;
+    
+    switch (model) {
+        case Model::spherical:
+            return nugget + sill * (t < 1.0 ? 1.5 * t - 0.5 * t * t * t
+                                            : 1.0);
+        case Model::exponential:
+            return nugget + sill * (1.0 - exp(-3.0 * t));
+        case Model::gaussian:
+            return nugget + sill * (1.0 - exp(-3.0 * t * t));
+    }
+    
+    throw std::runtime_error("Unknown variogram model!");
+}
+
+
+/* The system [C 1; 1^T 0] [w; mu] = [c0; 1] is not positive definite, so
+ * it is solved through C (symmetric, positive semidefinite) with LDLT:
+ * w = C^-1 c0 - mu C^-1 1, mu follows from sum(w) = 1. */
+void krige(KDTree const& tree, Kriging const& par, double const* values,
+           idx const ncol, std::vector<Point> const& targets,
+           double* out, double* var, idx* count)
+{
+    if (par.k <= 0) {
+        throw std::runtime_error("k should be positive!");
+    }
+    
+    if (par.vgm.range <= 0.0) {
+        throw std::runtime_error("Variogram range should be positive!");
+    }
+    
+    auto const nt = idx(targets.size()), n = tree.size();
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    auto const c00 = par.vgm.cov(0.0);
+    
+    // position of the points in the tree by their original index
+    std::vector<idx> pos(n);
+    
+    for (idx ii = 0; ii < n; ++ii) {
+        pos[tree.index[ii]] = ii;
+    }
+    
+    #pragma omp parallel
+    {
+        std::vector<idx> nbr(par.k);
+        std::vector<double> dist(par.k);
+        
+        Eigen::MatrixXd C(par.k, par.k);
+        Eigen::VectorXd c0(par.k), w(par.k), a(par.k), b(par.k);
+        Eigen::LDLT<Eigen::MatrixXd> ldlt(par.k);
+        
+        #pragma omp for schedule(dynamic, 64)
+        for (idx ii = 0; ii < nt; ++ii) {
+            auto const m = tree.knn(targets[ii], par.k, par.radius,
+                                    nbr.data(), dist.data());
+            auto res = out + ii * ncol;
+            double sigma2 = nan;
+            
+            if (count != nullptr) {
+                count[ii] = m;
+            }
+            
+            if (m == 0) {
+                std::fill(res, res + ncol, nan);
+                
+                if (var != nullptr) {
+                    var[ii] = nan;
+                }
+                continue;
+            }
+            
+            C.resize(m, m);
+            c0.resize(m);
+            
+            for (idx jj = 0; jj < m; ++jj) {
+                auto const& pj = tree.pts[pos[nbr[jj]]];
+                
+                C(jj, jj) = c00;
+                c0(jj) = par.vgm.cov(dist[jj]);
+                
+                for (idx kk = 0; kk < jj; ++kk) {
+                    auto const& pk = tree.pts[pos[nbr[kk]]];
+                    C(jj, kk) = C(kk, jj) = par.vgm.cov(sqrt(dist2(pj, pk)));
+                }
+            }
+            
+            ldlt.compute(C);
+            
+            a = ldlt.solve(c0);
+            b = ldlt.solve(Eigen::VectorXd::Ones(m));
+            
+            auto const sb = b.sum();
+            
+            if (ldlt.info() != Eigen::Success or sb == 0.0) {
+                std::fill(res, res + ncol, nan);
+            } else {
+                auto const mu = (a.sum() - 1.0) / sb;
+                
+                w = a - mu * b;
+                sigma2 = c00 - w.dot(c0) - mu;
+                
+                for (idx cc = 0; cc < ncol; ++cc) {
+                    double sum = 0.0;
+                    
+                    for (idx jj = 0; jj < m; ++jj) {
+                        sum += w(jj) * values[nbr[jj] * ncol + cc];
+                    }
+                    
+                    res[cc] = sum;
+                }
+            }
+            
+            if (var != nullptr) {
+                var[ii] = sigma2;
+            }
+        }
+    }
+}
+
+
+// splitmix64, selection of a point does not depend on the thread count
+static bool selected(unsigned long const seed, idx const ii,
+                     double const fraction)
+{
+    if (fraction >= 1.0) {
+        return true;
+    }
+    
+    uint64_t z = seed + uint64_t(ii) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    
+    return double(z >> 11) / 9007199254740992.0 < fraction;
+}
+
+
+void variogram(KDTree const& tree, double const* values, double const max_lag,
+               idx const nbins, double const fraction,
+               unsigned long const seed, double* lag, double* gamma,
+               idx* count)
+{
+    if (max_lag <= 0.0 or nbins <= 0) {
+        throw std::runtime_error("max_lag and nbins should be positive!");
+    }
+    
+    if (fraction <= 0.0) {
+        throw std::runtime_error("fraction should be positive!");
+    }
+    
+    auto const n = tree.size();
+    auto const width = max_lag / nbins;
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    
+    int nthread = 1;
+    
+    #ifdef _OPENMP
+    nthread = omp_get_max_threads();
+    #endif
+    
+    // partial sums of every thread, merged in thread order so the sums do
+    // not depend on the order in which the threads finish
+    std::vector<std::vector<double>> part_d(nthread), part_g(nthread);
+    std::vector<std::vector<idx>> part_n(nthread);
+    
+    #pragma omp parallel num_threads(nthread)
+    {
+        int tid = 0;
+        
+        #ifdef _OPENMP
+        tid = omp_get_thread_num();
+        #endif
+        
+        std::vector<idx> nbr;
+        std::vector<double> dist;
+        auto& pd = part_d[tid] = std::vector<double>(nbins, 0.0);
+        auto& pg = part_g[tid] = std::vector<double>(nbins, 0.0);
+        auto& pn = part_n[tid] = std::vector<idx>(nbins, 0);
+        
+        #pragma omp for schedule(static)
+        for (idx ii = 0; ii < n; ++ii) {
+            auto const first = tree.index[ii];
+            
+            if (not selected(seed, first, fraction)) {
+                continue;
+            }
+            
+            nbr.clear();
+            dist.clear();
+            tree.radius(tree.pts[ii], max_lag, nbr, dist, false);
+            
+            auto const v = values[first];
+            
+            for (idx jj = 0; jj < idx(nbr.size()); ++jj) {
+                auto const second = nbr[jj];
+                
+                // every pair once: by index among the first points
+                if (second == first or (second < first and
+                    selected(seed, second, fraction))) {
+                    continue;
+                }
+                
+                auto const bin = std::min(idx(dist[jj] / width), nbins - 1);
+                auto const diff = v - values[second];
+                
+                pd[bin] += dist[jj];
+                pg[bin] += diff * diff;
+                pn[bin]++;
+            }
+        }
+    }
+    
+    std::vector<double> sum_d(nbins, 0.0), sum_g(nbins, 0.0);
+    std::vector<idx> sum_n(nbins, 0);
+    
+    for (int tt = 0; tt < nthread; ++tt) {
+        // the runtime may have started less threads
+        if (part_n[tt].empty()) {
+            continue;
+        }
+        
+        for (idx bb = 0; bb < nbins; ++bb) {
+            sum_d[bb] += part_d[tt][bb];
+            sum_g[bb] += part_g[tt][bb];
+            sum_n[bb] += part_n[tt][bb];
+        }
+    }
+    
+    for (idx bb = 0; bb < nbins; ++bb) {
+        lag[bb] = sum_n[bb] > 0 ? sum_d[bb] / sum_n[bb] : nan;
+        gamma[bb] = sum_n[bb] > 0 ? 0.5 * sum_g[bb] / sum_n[bb] : nan;
+        count[bb] = sum_n[bb];
+    }
+}
+
+// namespace end
+}
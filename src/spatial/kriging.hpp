@@ -0,0 +1,102 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __KRIGING_HPP
+#define __KRIGING_HPP
+
+
+#include <vector>
+
+#include "spatial.hpp"
+
+
+namespace spatial {
+
+
+/* Variogram models, h is distance [m]. range is the practical range of
+ * the exponential and gaussian models. */
+enum class Model : int {
+    spherical = 0, exponential = 1, gaussian = 2
+};
+
+
+/* Variogram gamma(h) = nugget + sill * f(h / range) for h > 0,
+ * gamma(0) = 0; sill is the partial sill. */
+struct Variogram {
+    Model model = Model::spherical;
+    double nugget = 0.0, sill = 1.0, range = 1.0;
+    
+    Variogram() = default;
+    ~Variogram() = default;
+    
+    Variogram(Model const model, double const nugget, double const sill,
+              double const range)
+    : model(model), nugget(nugget), sill(sill), range(range) {}
+    
+    double operator()(double const h) const;
+    
+    // covariance, C(h) = nugget + sill - gamma(h)
+    double cov(double const h) const
+    {
+        return nugget + sill - (*this)(h);
+    }
+};
+
+
+/* Parameters of local ordinary kriging. Neighbours are the k nearest
+ * points not farther than radius [m] (radius > 0). */
+struct Kriging {
+    idx k = 16;
+    double radius = 0.0;
+    Variogram vgm;
+    
+    Kriging() = default;
+    ~Kriging() = default;
+    
+    Kriging(idx const k, double const radius, Variogram const& vgm)
+    : k(k), radius(radius), vgm(vgm) {}
+};
+
+
+/* Ordinary kriging of ncol columns of values (n x ncol, row-major) to the
+ * targets from their k nearest points; out has targets.size() x ncol
+ * elements. Every target solves its own k x k system, so memory does not
+ * grow with n^2. var (if not nullptr) is the kriging variance, count
+ * (if not nullptr) the number of neighbours used; targets without
+ * neighbours get NaN. Targets are processed in parallel. */
+void krige(KDTree const& tree, Kriging const& par, double const* values,
+           idx const ncol, std::vector<Point> const& targets,
+           double* out, double* var, idx* count);
+
+/* Empirical semivariogram of values (one per point) in nbins bins of
+ * width max_lag / nbins. Pairs come from radius queries of the tree,
+ * so the cost is proportional to the number of pairs within max_lag
+ * instead of n^2. With fraction < 1 only a random subset of the points
+ * (selected reproducibly from seed) are taken as first points of the
+ * pairs. lag is the mean distance of the pairs in a bin, gamma is
+ * sum (v_i - v_j)^2 / (2 count); empty bins get NaN. The results are
+ * reproducible for a given number of threads. */
+void variogram(KDTree const& tree, double const* values, double const max_lag,
+               idx const nbins, double const fraction,
+               unsigned long const seed, double* lag, double* gamma,
+               idx* count);
+
+// namespace end
+}
+
+// guard
+#endif
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "spatial.hpp"
+
+
+namespace spatial {
+
+using aux::arr_in;
+
+
+// WGS-84
+static constexpr double WA = 6378137.0, WB = 6356752.3142,
+                        E2 = (WA * WA - WB * WB) / (WA * WA),
+                        deg2rad = 3.14159265358979 / 180.0;
+
+
+Point ell_cart(double const lon, double const lat, double const h)
+{
+    double const fi = lat * deg2rad, la = lon * deg2rad,
+                 n = WA / sqrt(1.0 - E2 * sin(fi) * sin(fi));
+    
+    return Point((              n + h) * cos(fi) * cos(la),
+                 (              n + h) * cos(fi) * sin(la),
+                 ( (1.0 - E2) * n + h) * sin(fi));
+}
+
+
+std::vector<Point> to_points(arr_in coords)
+{
+    auto const vc = coords.const_view<double>(2);
+    
+    if (vc.shape(1) < 2) {
+        throw std::runtime_error("Coordinates should have longitude, latitude "
+                                 "and optionally height columns!");
+    }
+    
+    auto const has_height = vc.shape(1) > 2;
+    std::vector<Point> points(vc.shape(0));
+    
+    for (idx ii = 0; ii < vc.shape(0); ++ii) {
+        points[ii] = ell_cart(vc(ii, 0), vc(ii, 1),
+                              has_height ? vc(ii, 2) : 0.0);
+    }
+    
+    return points;
+}
+
+
+double dist2(Point const& a, Point const& b)
+{
+    double const dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+
+KDTree::KDTree(std::vector<Point> const& points)
+:
+pts(points.size()), index(points.size()), dim(points.size(), 0)
+{
+    for (idx ii = 0; ii < size(); ++ii) {
+        index[ii] = ii;
+    }
+    
+    build(0, size(), points);
+    
+    for (idx ii = 0; ii < size(); ++ii) {
+        pts[ii] = points[index[ii]];
+    }
+}
+
+
+void KDTree::build(idx const lo, idx const hi, std::vector<Point> const& points)
+{
+    if (hi - lo <= leaf_size) {
+        return;
+    }
+    
+    // split along the longest side of the bounding box
+    Point pmin = points[index[lo]], pmax = pmin;
+    
+    for (idx ii = lo + 1; ii < hi; ++ii) {
+        auto const& p = points[index[ii]];
+        pmin = Point(std::min(pmin.x, p.x), std::min(pmin.y, p.y),
+                     std::min(pmin.z, p.z));
+        pmax = Point(std::max(pmax.x, p.x), std::max(pmax.y, p.y),
+                     std::max(pmax.z, p.z));
+    }
+    
+    int dd = 0;
+    
+    for (int jj = 1; jj < 3; ++jj) {
+        if (pmax[jj] - pmin[jj] > pmax[dd] - pmin[dd]) {
+            dd = jj;
+        }
+    }
+    
+    auto const mid = lo + (hi - lo) / 2;
+    dim[mid] = static_cast<unsigned char>(dd);
+    
+    std::nth_element(index.begin() + lo, index.begin() + mid,
+                     index.begin() + hi,
+                     [&points, dd](idx const a, idx const b) {
+                         return points[a][dd] < points[b][dd];
+                     });
+    
+    build(lo, mid, points);
+    build(mid + 1, hi, points);
+}
+
+
+void KDTree::knn(idx const lo, idx const hi, Point const& q, idx const k,
+                 double const max_d2, heap_t& heap) const
+{
+    auto consider = [&](idx const ii) {
+        auto const d2 = dist2(q, pts[ii]);
+        
+        if (d2 > max_d2) {
+            return;
+        }
+        
+        if (idx(heap.size()) < k) {
+            heap.emplace_back(d2, ii);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (std::make_pair(d2, ii) < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = std::make_pair(d2, ii);
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+    
+    if (hi - lo <= leaf_size) {
+        for (idx ii = lo; ii < hi; ++ii) {
+            consider(ii);
+        }
+        return;
+    }
+    
+    auto const mid = lo + (hi - lo) / 2;
+    auto const diff = q[dim[mid]] - pts[mid][dim[mid]];
+    
+    consider(mid);
+    
+    if (diff < 0.0) {
+        knn(lo, mid, q, k, max_d2, heap);
+    } else {
+        knn(mid + 1, hi, q, k, max_d2, heap);
+    }
+    
+    auto const worst = idx(heap.size()) < k ? max_d2 : heap.front().first;
+    
+    if (diff * diff <= worst) {
+        if (diff < 0.0) {
+            knn(mid + 1, hi, q, k, max_d2, heap);
+        } else {
+            knn(lo, mid, q, k, max_d2, heap);
+        }
+    }
+}
+
+
+idx KDTree::knn(Point const& q, idx const k, double const max_dist,
+                idx* nbr, double* dist) const
+{
+    heap_t heap;
+    heap.reserve(k);
+    
+    auto const max_d2 = max_dist > 0.0 ? max_dist * max_dist
+                                       : std::numeric_limits<double>::max();
+    
+    if (k > 0 and size() > 0) {
+        knn(0, size(), q, k, max_d2, heap);
+    }
+    
+    std::sort_heap(heap.begin(), heap.end());
+    
+    for (idx ii = 0; ii < idx(heap.size()); ++ii) {
+        nbr[ii] = index[heap[ii].second];
+        dist[ii] = sqrt(heap[ii].first);
+    }
+    
+    return idx(heap.size());
+}
+
+
+void KDTree::radius(idx const lo, idx const hi, Point const& q,
+                    double const r2, heap_t& found) const
+{
+    if (hi - lo <= leaf_size) {
+        for (idx ii = lo; ii < hi; ++ii) {
+            auto const d2 = dist2(q, pts[ii]);
+            if (d2 <= r2) {
+                found.emplace_back(d2, ii);
+            }
+        }
+        return;
+    }
+    
+    auto const mid = lo + (hi - lo) / 2;
+    auto const diff = q[dim[mid]] - pts[mid][dim[mid]];
+    auto const d2 = dist2(q, pts[mid]);
+    
+    if (d2 <= r2) {
+        found.emplace_back(d2, mid);
+    }
+    
+    if (diff <= 0.0 or diff * diff <= r2) {
+        radius(lo, mid, q, r2, found);
+    }
+    
+    if (diff >= 0.0 or diff * diff <= r2) {
+        radius(mid + 1, hi, q, r2, found);
+    }
+}
+
+
+void KDTree::radius(Point const& q, double const radius,
+                    std::vector<idx>& nbr, std::vector<double>& dist,
+                    bool const sorted) const
+{
+    heap_t found;
+    
+    if (size() > 0) {
+        this->radius(0, size(), q, radius * radius, found);
+    }
+    
+    if (sorted) {
+        std::sort(found.begin(), found.end());
+    }
+    
+    for (auto const& f : found) {
+        nbr.push_back(index[f.second]);
+        dist.push_back(sqrt(f.first));
+    }
+}
+
+
+void interpolate(KDTree const& tree, IDW const& par, double const* values,
+                 idx const ncol, std::vector<Point> const& targets,
+                 double* out, idx* count)
+{
+    if (par.k <= 0 and par.radius <= 0.0) {
+        throw std::runtime_error("Either k or radius should be positive!");
+    }
+    
+    auto const nt = idx(targets.size());
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    
+    #pragma omp parallel
+    {
+        std::vector<idx> nbr(par.k > 0 ? par.k : 0);
+        std::vector<double> dist(par.k > 0 ? par.k : 0), sumwv(ncol);
+        
+        #pragma omp for schedule(dynamic, 64)
+        for (idx ii = 0; ii < nt; ++ii) {
+            idx m = 0;
+            
+            if (par.k > 0) {
+                m = tree.knn(targets[ii], par.k, par.radius, nbr.data(),
+                             dist.data());
+            } else {
+                nbr.clear();
+                dist.clear();
+                tree.radius(targets[ii], par.radius, nbr, dist);
+                m = idx(nbr.size());
+            }
+            
+            auto res = out + ii * ncol;
+            double sumw = 0.0;
+            
+            std::fill(sumwv.begin(), sumwv.end(), 0.0);
+            
+            for (idx jj = 0; jj < m; ++jj) {
+                auto const val = values + nbr[jj] * ncol;
+                
+                // neighbours are sorted, only the first can be at zero distance
+                if (dist[jj] == 0.0) {
+                    std::copy(val, val + ncol, sumwv.begin());
+                    sumw = 1.0;
+                    break;
+                }
+                
+                auto const w = par.power == 2.0 ? 1.0 / dist[jj] / dist[jj]
+                                                : pow(dist[jj], -par.power);
+                sumw += w;
+                
+                for (idx cc = 0; cc < ncol; ++cc) {
+                    sumwv[cc] += w * val[cc];
+                }
+            }
+            
+            for (idx cc = 0; cc < ncol; ++cc) {
+                res[cc] = m > 0 ? sumwv[cc] / sumw : nan;
+            }
+            
+            if (count != nullptr) {
+                count[ii] = m;
+            }
+        }
+    }
+}
+
+// namespace end
+}
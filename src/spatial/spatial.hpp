@@ -0,0 +1,126 @@
+/* Copyright (C) 2018  István Bozsó
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SPATIAL_HPP
+#define __SPATIAL_HPP
+
+
+#include <vector>
+
+#include "aux.hpp"
+
+
+namespace spatial {
+
+using aux::idx;
+
+
+/* WGS-84 cartesian coordinates of a point */
+struct Point {
+    double x = 0.0, y = 0.0, z = 0.0;
+    
+    Point() = default;
+    ~Point() = default;
+    
+    Point(double const x, double const y, double const z) : x(x), y(y), z(z) {}
+    
+    double operator[](int const ii) const
+    {
+        return ii == 0 ? x : (ii == 1 ? y : z);
+    }
+};
+
+
+/* longitude, latitude [degree] and height [m] to cartesian coordinates */
+Point ell_cart(double const lon, double const lat, double const h);
+
+/* rows of longitude, latitude, height to cartesian coordinates */
+std::vector<Point> to_points(aux::arr_in coords);
+
+
+double dist2(Point const& a, Point const& b);
+
+
+/* Static kd-tree of points in 3D cartesian space. Distances are the
+ * same as the ones used by daisy estim_dominant. Points are reordered
+ * so that the nodes are implicit: the node of [lo, hi) splits at
+ * mid = (lo + hi) / 2 along dim[mid], ranges not longer than leaf_size
+ * are leaves. */
+struct KDTree {
+    static constexpr idx leaf_size = 16;
+    
+    std::vector<Point> pts;          // points in tree order
+    std::vector<idx> index;          // original indices of the points
+    std::vector<unsigned char> dim;  // splitting dimensions of nodes
+    
+    KDTree() = default;
+    ~KDTree() = default;
+    
+    explicit KDTree(std::vector<Point> const& points);
+    
+    idx size() const { return idx(pts.size()); }
+    
+    /* At most k nearest points not farther than max_dist, sorted by
+     * distance. Returns the number of points found. */
+    idx knn(Point const& q, idx const k, double const max_dist,
+            idx* nbr, double* dist) const;
+    
+    /* All points closer than or as close as radius, sorted by
+     * distance unless sorted is false. */
+    void radius(Point const& q, double const radius,
+                std::vector<idx>& nbr, std::vector<double>& dist,
+                bool const sorted = true) const;
+    
+private:
+    using heap_t = std::vector<std::pair<double, idx>>;
+    
+    void build(idx const lo, idx const hi, std::vector<Point> const& points);
+    void knn(idx const lo, idx const hi, Point const& q, idx const k,
+             double const max_d2, heap_t& heap) const;
+    void radius(idx const lo, idx const hi, Point const& q,
+                double const r2, heap_t& found) const;
+};
+
+
+/* Parameters of inverse distance weighting. Neighbours are the k nearest
+ * points (k > 0) not farther than radius [m] (radius > 0), weights are
+ * 1 / d^power; power = 2 gives the weights of daisy estim_dominant. */
+struct IDW {
+    idx k = 0;
+    double radius = 0.0, power = 2.0;
+    
+    IDW() = default;
+    ~IDW() = default;
+    
+    IDW(idx const k, double const radius, double const power)
+    : k(k), radius(radius), power(power) {}
+};
+
+
+/* Interpolation of ncol columns of values (n x ncol, row-major) to the
+ * targets, out has targets.size() x ncol elements. A point at zero
+ * distance gives its own values, targets without neighbours get NaN.
+ * count (if not nullptr) is the number of neighbours used. Targets are
+ * processed in parallel. */
+void interpolate(KDTree const& tree, IDW const& par, double const* values,
+                 idx const ncol, std::vector<Point> const& targets,
+                 double* out, idx* count);
+
+// namespace end
+}
+
+// guard
+#endif